@@ -0,0 +1,119 @@
+#include "common.h"
+
+#include <nova/array_stream.h>
+#include <nova/fast_format.h>
+
+#include <cstdio>
+#include <sstream>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* ns/op of building a short key "user:<int>:<double>:<string>" from scratch,
+ * the way hot logging and cache key code does it. */
+
+namespace
+{
+
+constexpr std::size_t value_mask = value_count - 1;
+
+void array_outstream_key(benchmark::State& state)
+{
+    const auto& ints = values<int>();
+    const auto& doubles = values<double>();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        array_outstream<128> out;
+        out << "user:" << ints[i & value_mask] << ':' << doubles[i & value_mask] << ":name";
+        benchmark::DoNotOptimize(out.view().data());
+        ++i;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void span_outstream_key(benchmark::State& state)
+{
+    const auto& ints = values<int>();
+    const auto& doubles = values<double>();
+    char buffer[128];
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        span_outstream out{buffer};
+        out << "user:" << ints[i & value_mask] << ':' << doubles[i & value_mask] << ":name";
+        benchmark::DoNotOptimize(out.view().data());
+        ++i;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void array_outstream_reused_key(benchmark::State& state)
+{
+    const auto& ints = values<int>();
+    const auto& doubles = values<double>();
+    array_outstream<128> out;
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        out.reset();
+        out << "user:" << ints[i & value_mask] << ':' << doubles[i & value_mask] << ":name";
+        benchmark::DoNotOptimize(out.view().data());
+        ++i;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void array_outstream_fast_format_key(benchmark::State& state)
+{
+    const auto& ints = values<int>();
+    const auto& doubles = values<double>();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        array_outstream<128> out;
+        out << fast_format << "user:" << ints[i & value_mask] << ':' << doubles[i & value_mask] << ":name";
+        benchmark::DoNotOptimize(out.view().data());
+        ++i;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void snprintf_key(benchmark::State& state)
+{
+    const auto& ints = values<int>();
+    const auto& doubles = values<double>();
+    char buffer[128];
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        std::snprintf(buffer, sizeof(buffer), "user:%d:%g:name", ints[i & value_mask], doubles[i & value_mask]);
+        benchmark::DoNotOptimize(buffer);
+        ++i;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void std_ostringstream_key(benchmark::State& state)
+{
+    const auto& ints = values<int>();
+    const auto& doubles = values<double>();
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        std::ostringstream out;
+        out << "user:" << ints[i & value_mask] << ':' << doubles[i & value_mask] << ":name";
+        benchmark::DoNotOptimize(out.str().data());
+        ++i;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+}
+
+BENCHMARK(array_outstream_key);
+BENCHMARK(span_outstream_key);
+BENCHMARK(array_outstream_reused_key);
+BENCHMARK(array_outstream_fast_format_key);
+BENCHMARK(snprintf_key);
+BENCHMARK(std_ostringstream_key);
@@ -0,0 +1,71 @@
+#include "common.h"
+
+#include <nova/async_sink.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* Producer side cost of writing 1Kb records into a sink which takes 100us
+ * per write, like a slow disk: synchronous buffered stream against
+ * nova::async_sink with the same buffer size. max_us is the worst single
+ * write seen by the producer. */
+
+namespace
+{
+
+class slow_sink
+{
+public:
+    typedef sink category;
+    typedef char char_type;
+
+    std::streamsize write(const char_type* , std::streamsize n)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        return n;
+    }
+    void flush() { }
+};
+
+typedef buffering<64 * 1024> buffer_64k;
+
+template<typename Stream>
+void record_loop(benchmark::State& state, Stream& out)
+{
+    std::vector<char> record(1024, 'x');
+    std::chrono::steady_clock::duration worst{};
+    for (auto _ : state)
+    {
+        auto start = std::chrono::steady_clock::now();
+        out.write(record.data(), static_cast<std::streamsize>(record.size()));
+        worst = std::max(worst, std::chrono::steady_clock::now() - start);
+    }
+    state.counters["max_us"] = std::chrono::duration<double, std::micro>(worst).count();
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * record.size()));
+}
+
+void sync_slow_write(benchmark::State& state)
+{
+    outstream<slow_sink, buffer_64k> out;
+    record_loop(state, out);
+}
+
+void async_slow_write(benchmark::State& state)
+{
+    async_params params;
+    params.buffer_size = 64 * 1024;
+    params.buffers = static_cast<std::size_t>(state.range(0));
+    outstream<async_sink<slow_sink>> out{params};
+    record_loop(state, out);
+    out.flush();
+    out->drain();
+}
+
+}
+
+/* Throughput is bound by the sink either way, limit iterations to what it can take. */
+BENCHMARK(sync_slow_write)->Iterations(1 << 14)->UseRealTime();
+BENCHMARK(async_slow_write)->Arg(4)->Arg(64)->Iterations(1 << 14)->UseRealTime();
@@ -0,0 +1,138 @@
+#include <nova/io.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+using namespace nova;
+
+namespace
+{
+
+/* Hands out the same chunk over and over: measures the stream, not the memory. */
+class chunk_sink
+{
+public:
+    typedef out_buffer_provider category;
+    typedef char char_type;
+
+    chunk_sink() : _chunk(64 * 1024) {}
+
+    std::pair<char_type*, std::size_t> get_out_buffer() { return {_chunk.data(), _chunk.size()}; }
+    void flush(std::size_t size) { benchmark::DoNotOptimize(size); }
+private:
+    std::vector<char_type> _chunk;
+};
+
+class view_provider
+{
+public:
+    typedef in_buffer_provider category;
+    typedef char char_type;
+
+    explicit view_provider(std::string_view str) : _str{str} {}
+
+    std::pair<const char_type*, std::size_t> get_in_buffer()
+    {
+        if (_provided) return {nullptr, 0};
+        _provided = true;
+        return {_str.data(), _str.size()};
+    }
+private:
+    std::string_view _str;
+    bool _provided = false;
+};
+
+void nova_provider_write(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    outstream<chunk_sink> out;
+    for (auto _ : state) out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void nova_provider_out_span(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    outstream<chunk_sink> out;
+    for (auto _ : state)
+    {
+        std::size_t done = 0;
+        while (done < block.size())
+        {
+            auto [buf, size] = out.out_span();
+            std::size_t chunk = std::min(size, block.size() - done);
+            std::memset(buf, 'x', chunk);
+            out.commit(chunk);
+            done += chunk;
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void std_stringstream_write(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    for (auto _ : state)
+    {
+        std::ostringstream out;
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        benchmark::DoNotOptimize(out.tellp());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void nova_provider_read(benchmark::State& state)
+{
+    std::string data(static_cast<std::size_t>(state.range(0)), 'x');
+    std::vector<char> block(data.size());
+    for (auto _ : state)
+    {
+        instream<view_provider> in{data};
+        in.read(block.data(), static_cast<std::streamsize>(block.size()));
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void nova_provider_in_span(benchmark::State& state)
+{
+    std::string data(static_cast<std::size_t>(state.range(0)), 'x');
+    for (auto _ : state)
+    {
+        instream<view_provider> in{data};
+        std::size_t sum = 0;
+        for (auto [buf, size] = in.in_span(); buf; std::tie(buf, size) = in.in_span())
+        {
+            sum += size;
+            in.consume(size);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void std_stringstream_read(benchmark::State& state)
+{
+    std::string data(static_cast<std::size_t>(state.range(0)), 'x');
+    std::vector<char> block(data.size());
+    for (auto _ : state)
+    {
+        std::istringstream in{data};
+        in.read(block.data(), static_cast<std::streamsize>(block.size()));
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK(nova_provider_write)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(nova_provider_out_span)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(std_stringstream_write)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(nova_provider_read)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(nova_provider_in_span)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(std_stringstream_read)->RangeMultiplier(16)->Range(16, 4<<20);
@@ -0,0 +1,164 @@
+#include <nova/fd_device.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+using namespace nova;
+
+namespace
+{
+
+template<typename Buffering>
+void nova_write(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    outstream<file_sink, Buffering> out{"/dev/null"};
+    for (auto _ : state) out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    out.flush();
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+/* Real file writes: whole 64Mb file per iteration. */
+constexpr std::size_t file_size = 64 << 20;
+constexpr const char* file_name = "nstream_bench.tmp";
+
+template<typename Buffering>
+void nova_file_write(benchmark::State& state, const fd_params& params)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    for (auto _ : state)
+    {
+        outstream<file_sink, Buffering> out{file_name, std::ios_base::out, params};
+        for (std::size_t done = 0; done < file_size; done += block.size())
+        {
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        }
+        out.flush();
+    }
+    std::remove(file_name);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+}
+
+void std_ofstream_file_write(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    for (auto _ : state)
+    {
+        std::ofstream out{file_name};
+        for (std::size_t done = 0; done < file_size; done += block.size())
+        {
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        }
+        out.flush();
+    }
+    std::remove(file_name);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+}
+
+void nova_file_write_buffered(benchmark::State& state) { nova_file_write<buffer_8k>(state, fd_params{}); }
+
+void nova_file_write_gathered(benchmark::State& state)
+{
+    fd_params params;
+    params.buffer_size = 64 << 10;
+    nova_file_write<non_buffered>(state, params);
+}
+
+void nova_file_write_direct(benchmark::State& state)
+{
+    fd_params params;
+    params.direct = true;
+    nova_file_write<non_buffered>(state, params);
+}
+
+void std_ofstream_write(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    std::ofstream out{"/dev/null"};
+    for (auto _ : state) out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    out.flush();
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+/* file_sink counting the system calls, with or without write_v. */
+class counting_sink
+{
+public:
+    typedef sink category;
+    typedef char char_type;
+
+    explicit counting_sink(const char* path) : _sink{path} {}
+
+    std::streamsize write(const char_type* s, std::streamsize n)
+    {
+        ++calls;
+        return _sink.write(s, n);
+    }
+    void flush() { _sink.flush(); }
+
+    std::size_t calls = 0;
+protected:
+    file_sink _sink;
+};
+
+class counting_vectored_sink : public counting_sink
+{
+public:
+    using counting_sink::counting_sink;
+
+    std::streamsize write_v(const std::pair<const char_type*, std::size_t>* spans, int count)
+    {
+        ++calls;
+        return _sink.write_v(spans, count);
+    }
+};
+
+/* Framed messages: a short formatted header followed by a large payload. */
+template<typename Sink>
+void nova_framed_write(benchmark::State& state)
+{
+    std::vector<char> payload(static_cast<std::size_t>(state.range(0)), 'x');
+    outstream<Sink, buffer_8k> out{"/dev/null"};
+    int id = 0;
+    for (auto _ : state)
+    {
+        out << "id=" << id++ << " size=" << payload.size() << '\n';
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    }
+    out.flush();
+    state.counters["syscalls_per_msg"] = static_cast<double>(out->calls) / static_cast<double>(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template<typename Buffering>
+void nova_read(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)));
+    instream<file_source, Buffering> in{"/dev/zero"};
+    for (auto _ : state) in.read(block.data(), static_cast<std::streamsize>(block.size()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void std_ifstream_read(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)));
+    std::ifstream in{"/dev/zero"};
+    for (auto _ : state) in.read(block.data(), static_cast<std::streamsize>(block.size()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK_TEMPLATE(nova_write, buffer_8k)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(std_ofstream_write)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(nova_file_write_buffered)->Arg(256)->Arg(64<<10)->Unit(benchmark::kMillisecond);
+BENCHMARK(nova_file_write_gathered)->Arg(256)->Arg(64<<10)->Unit(benchmark::kMillisecond);
+BENCHMARK(nova_file_write_direct)->Arg(256)->Arg(64<<10)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(nova_framed_write, counting_sink)->Arg(16<<10)->Arg(256<<10);
+BENCHMARK_TEMPLATE(nova_framed_write, counting_vectored_sink)->Arg(16<<10)->Arg(256<<10);
+BENCHMARK(std_ofstream_file_write)->Arg(256)->Arg(64<<10)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(nova_read, buffer_8k)->RangeMultiplier(16)->Range(16, 4<<20);
+BENCHMARK(std_ifstream_read)->RangeMultiplier(16)->Range(16, 4<<20);
@@ -0,0 +1,154 @@
+#ifndef NOVA_BENCH_COMMON_H
+#define NOVA_BENCH_COMMON_H
+
+#include <nova/io.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Expands REGISTER(Buffering) for every buffering<N> typedef. */
+#define NOVA_BENCH_ALL_BUFFERINGS(REGISTER) \
+    REGISTER(nova::non_buffered)          \
+    REGISTER(nova::buffer_8)              \
+    REGISTER(nova::buffer_16)             \
+    REGISTER(nova::buffer_32)             \
+    REGISTER(nova::buffer_64)             \
+    REGISTER(nova::buffer_128)            \
+    REGISTER(nova::buffer_256)            \
+    REGISTER(nova::buffer_512)            \
+    REGISTER(nova::buffer_1k)             \
+    REGISTER(nova::buffer_2k)             \
+    REGISTER(nova::buffer_4k)             \
+    REGISTER(nova::buffer_8k)
+
+namespace nova_bench
+{
+
+/* Discards everything: measures the stream, not the device. */
+class null_sink
+{
+public:
+    typedef nova::sink category;
+    typedef char char_type;
+
+    std::streamsize write(const char_type* , std::streamsize n) { return n; }
+    void flush() { }
+};
+
+/* Hands out the same chunk over and over. */
+class chunk_sink
+{
+public:
+    typedef nova::out_buffer_provider category;
+    typedef char char_type;
+
+    chunk_sink() : _chunk(64 * 1024) {}
+
+    std::pair<char_type*, std::size_t> get_out_buffer() { return {_chunk.data(), _chunk.size()}; }
+    void flush(std::size_t size) { benchmark::DoNotOptimize(size); }
+private:
+    std::vector<char_type> _chunk;
+};
+
+/* Reads the same text over and over. */
+class cyclic_source
+{
+public:
+    typedef nova::source category;
+    typedef char char_type;
+
+    explicit cyclic_source(std::string_view text) : _text{text} {}
+
+    std::streamsize read(char_type* s, std::streamsize n)
+    {
+        std::streamsize done = 0;
+        while (done < n)
+        {
+            std::size_t chunk = std::min(static_cast<std::size_t>(n - done), _text.size() - _pos);
+            std::memcpy(s + done, _text.data() + _pos, chunk);
+            done += static_cast<std::streamsize>(chunk);
+            _pos += chunk;
+            if (_pos == _text.size()) _pos = 0;
+        }
+        return done;
+    }
+private:
+    std::string_view _text;
+    std::size_t _pos = 0;
+};
+
+/* Provides the same text over and over. */
+class cyclic_provider
+{
+public:
+    typedef nova::in_buffer_provider category;
+    typedef char char_type;
+
+    explicit cyclic_provider(std::string_view text) : _text{text} {}
+
+    std::pair<const char_type*, std::size_t> get_in_buffer() { return {_text.data(), _text.size()}; }
+private:
+    std::string_view _text;
+};
+
+/* Number of distinct values cycled through by the formatted benchmarks, power of 2. */
+constexpr std::size_t value_count = 1024;
+
+template<typename T>
+const std::vector<T>& values();
+
+template<>
+inline const std::vector<int>& values<int>()
+{
+    static const std::vector<int> vals = []
+    {
+        std::mt19937 rng{1};
+        std::uniform_int_distribution<int> dist{-1000000, 1000000};
+        std::vector<int> res(value_count);
+        for (auto& v : res) v = dist(rng);
+        return res;
+    }();
+    return vals;
+}
+
+template<>
+inline const std::vector<double>& values<double>()
+{
+    static const std::vector<double> vals = []
+    {
+        std::mt19937 rng{2};
+        std::uniform_real_distribution<double> dist{-1e6, 1e6};
+        std::vector<double> res(value_count);
+        for (auto& v : res) v = dist(rng);
+        return res;
+    }();
+    return vals;
+}
+
+template<>
+inline const std::vector<std::string>& values<std::string>()
+{
+    static const std::vector<std::string> vals = []
+    {
+        std::mt19937 rng{3};
+        std::uniform_int_distribution<int> len{3, 12};
+        std::uniform_int_distribution<int> letter{'a', 'z'};
+        std::vector<std::string> res(value_count);
+        for (auto& v : res)
+        {
+            v.resize(static_cast<std::size_t>(len(rng)));
+            for (auto& ch : v) ch = static_cast<char>(letter(rng));
+        }
+        return res;
+    }();
+    return vals;
+}
+
+}
+
+#endif // NOVA_BENCH_COMMON_H
@@ -0,0 +1,221 @@
+#include "common.h"
+
+#include <nova/buffer_pool.h>
+#include <nova/stream_pool.h>
+
+#include <sstream>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* Cost of creating a stream, using it once and destroying it. */
+
+namespace
+{
+
+/* Provider over a caller's array: constructing it costs nothing. */
+class array_sink
+{
+public:
+    typedef out_buffer_provider category;
+    typedef char char_type;
+
+    explicit array_sink(char_type* buf) : _buf{buf} {}
+
+    std::pair<char_type*, std::size_t> get_out_buffer() { return {_buf, 64}; }
+    void flush(std::size_t ) { }
+private:
+    char_type* _buf;
+};
+
+/* Returns a single character once. */
+class char_source
+{
+public:
+    typedef source category;
+    typedef char char_type;
+
+    std::streamsize read(char_type* s, std::streamsize )
+    {
+        if (_done) return 0;
+        _done = true;
+        *s = 'x';
+        return 1;
+    }
+private:
+    bool _done = false;
+};
+
+template<typename Buffering, typename Allocator>
+void nova_outstream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        outstream<null_sink, Buffering, std::char_traits<char>, Allocator> out;
+        out << 'x';
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+template<typename Buffering>
+void nova_inline_outstream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        inline_outstream<null_sink, Buffering> out;
+        out << 'x';
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+void nova_provider_outstream_construct(benchmark::State& state)
+{
+    char buf[64];
+    for (auto _ : state)
+    {
+        outstream<array_sink> out{buf};
+        out << 'x';
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+void nova_inline_provider_outstream_construct(benchmark::State& state)
+{
+    char buf[64];
+    for (auto _ : state)
+    {
+        inline_outstream<array_sink> out{buf};
+        out << 'x';
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+template<typename Buffering>
+void nova_instream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        instream<char_source, Buffering> in;
+        char ch;
+        in >> ch;
+        benchmark::DoNotOptimize(ch);
+    }
+}
+
+template<typename Buffering>
+void nova_inline_instream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        inline_instream<char_source, Buffering> in;
+        char ch;
+        in >> ch;
+        benchmark::DoNotOptimize(ch);
+    }
+}
+
+void nova_provider_instream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        instream<cyclic_provider> in{"x"};
+        char ch;
+        in >> ch;
+        benchmark::DoNotOptimize(ch);
+    }
+}
+
+void nova_inline_provider_instream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        inline_instream<cyclic_provider> in{"x"};
+        char ch;
+        in >> ch;
+        benchmark::DoNotOptimize(ch);
+    }
+}
+
+/* The same stream object reused for every message. */
+template<typename Buffering>
+void nova_outstream_rebind(benchmark::State& state)
+{
+    outstream<null_sink, Buffering> out;
+    for (auto _ : state)
+    {
+        out.rebind();
+        out << 'x';
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+template<typename Buffering>
+void nova_instream_rebind(benchmark::State& state)
+{
+    instream<char_source, Buffering> in;
+    for (auto _ : state)
+    {
+        in.rebind();
+        char ch;
+        in >> ch;
+        benchmark::DoNotOptimize(ch);
+    }
+}
+
+template<typename Buffering>
+void nova_pooled_outstream(benchmark::State& state)
+{
+    stream_pool<outstream<null_sink, Buffering>> pool;
+    for (auto _ : state)
+    {
+        auto out = pool.acquire();
+        *out << 'x';
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+void std_ostringstream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        std::ostringstream out;
+        out << 'x';
+        benchmark::DoNotOptimize(out);
+    }
+}
+
+void std_istringstream_construct(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        std::istringstream in{"x"};
+        char ch;
+        in >> ch;
+        benchmark::DoNotOptimize(ch);
+    }
+}
+
+}
+
+#define NOVA_CONSTRUCT(Buffering)                                                  \
+    BENCHMARK_TEMPLATE(nova_outstream_construct, Buffering, std::allocator<char>); \
+    BENCHMARK_TEMPLATE(nova_inline_outstream_construct, Buffering);                \
+    BENCHMARK_TEMPLATE(nova_instream_construct, Buffering);                        \
+    BENCHMARK_TEMPLATE(nova_inline_instream_construct, Buffering);
+NOVA_BENCH_ALL_BUFFERINGS(NOVA_CONSTRUCT)
+NOVA_CONSTRUCT(nova::dynamic_buffering)
+NOVA_CONSTRUCT(nova::adaptive_buffering)
+BENCHMARK_TEMPLATE(nova_outstream_construct, buffer_4k, pool_allocator<char>);
+BENCHMARK_TEMPLATE(nova_outstream_construct, non_buffered, pool_allocator<char>);
+BENCHMARK(nova_provider_outstream_construct);
+BENCHMARK(nova_provider_instream_construct);
+BENCHMARK(nova_inline_provider_outstream_construct);
+BENCHMARK(nova_inline_provider_instream_construct);
+BENCHMARK_TEMPLATE(nova_outstream_rebind, non_buffered);
+BENCHMARK_TEMPLATE(nova_outstream_rebind, buffer_4k);
+BENCHMARK_TEMPLATE(nova_instream_rebind, non_buffered);
+BENCHMARK_TEMPLATE(nova_instream_rebind, buffer_4k);
+BENCHMARK_TEMPLATE(nova_pooled_outstream, non_buffered);
+BENCHMARK_TEMPLATE(nova_pooled_outstream, buffer_4k);
+BENCHMARK(std_ostringstream_construct);
+BENCHMARK(std_istringstream_construct);
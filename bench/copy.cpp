@@ -0,0 +1,100 @@
+#include <nova/fd_device.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace nova;
+
+/* Moving 64Mb from one file to another through streams: istreambuf_iterator
+ * std::copy and rdbuf insertion of the standard streams against nova::copy,
+ * which stays in the kernel (copy_file_range) for file_source/file_sink,
+ * and nova::copy forced through user space. */
+
+namespace
+{
+
+constexpr std::size_t file_size = 64 << 20;
+constexpr const char* in_name = "nstream_bench_copy_in.tmp";
+constexpr const char* out_name = "nstream_bench_copy_out.tmp";
+
+typedef buffering<64 * 1024> buffer_64k;
+
+void make_file()
+{
+    std::vector<char> block(1 << 20, 'x');
+    outstream<file_sink, non_buffered> out{in_name};
+    for (std::size_t done = 0; done < file_size; done += block.size())
+    {
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+}
+
+/* file_source without the transfer overload. */
+class user_space_source
+{
+public:
+    typedef source category;
+    typedef char char_type;
+
+    explicit user_space_source(const char* path) : _source{path} {}
+
+    std::streamsize read(char_type* s, std::streamsize n) { return _source.read(s, n); }
+private:
+    file_source _source;
+};
+
+void std_iterator_copy(benchmark::State& state)
+{
+    make_file();
+    for (auto _ : state)
+    {
+        std::ifstream in{in_name, std::ios::binary};
+        std::ofstream out{out_name, std::ios::binary};
+        std::copy(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{},
+                  std::ostreambuf_iterator<char>{out});
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(file_size));
+    std::remove(in_name);
+    std::remove(out_name);
+}
+
+void std_rdbuf_copy(benchmark::State& state)
+{
+    make_file();
+    for (auto _ : state)
+    {
+        std::ifstream in{in_name, std::ios::binary};
+        std::ofstream out{out_name, std::ios::binary};
+        out << in.rdbuf();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(file_size));
+    std::remove(in_name);
+    std::remove(out_name);
+}
+
+template<typename Source>
+void nova_copy(benchmark::State& state)
+{
+    make_file();
+    for (auto _ : state)
+    {
+        instream<Source, buffer_64k> in{in_name};
+        outstream<file_sink, buffer_64k> out{out_name};
+        benchmark::DoNotOptimize(copy(in, out));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(file_size));
+    std::remove(in_name);
+    std::remove(out_name);
+}
+
+}
+
+BENCHMARK(std_iterator_copy)->Unit(benchmark::kMillisecond);
+BENCHMARK(std_rdbuf_copy)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(nova_copy, file_source)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(nova_copy, user_space_source)->Unit(benchmark::kMillisecond);
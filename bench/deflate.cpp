@@ -0,0 +1,55 @@
+#include <nova/deflate_filter.h>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+
+using namespace nova;
+
+namespace
+{
+
+class null_sink
+{
+public:
+    typedef sink category;
+    typedef char char_type;
+
+    std::streamsize write(const char_type* , std::streamsize n) { return n; }
+    void flush() { }
+};
+
+const std::string& text()
+{
+    static const std::string data = []
+    {
+        std::mt19937 rng{42};
+        std::string words[] = {"alpha ", "beta ", "gamma ", "delta ", "epsilon\n", "1234 ", "5678 "};
+        std::string res;
+        while (res.size() < (16 << 20)) res += words[rng() % 7];
+        return res;
+    }();
+    return data;
+}
+
+void deflate_compress(benchmark::State& state)
+{
+    const std::string& data = text();
+    deflate_params params;
+    params.level = 6;
+    params.threads = static_cast<unsigned>(state.range(0));
+    for (auto _ : state)
+    {
+        deflate_outstream<null_sink> out;
+        out->filter<deflate_compressor>().set_params(params);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        out.flush();
+        out->close();
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+}
+
+BENCHMARK(deflate_compress)->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
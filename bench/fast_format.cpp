@@ -0,0 +1,49 @@
+#include "common.h"
+
+#include <nova/fast_format.h>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* nova::fast_format against the standard formatted insertion of the same
+ * stream; see formatted.cpp for the std baselines. */
+
+namespace
+{
+
+template<typename Stream, typename T>
+void insert_loop(benchmark::State& state, Stream& out)
+{
+    const auto& vals = values<T>();
+    std::size_t i = 0;
+    for (auto _ : state) out << vals[i++ & (value_count - 1)] << ' ';
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<typename Sink, typename Buffering, typename T>
+void standard_insert(benchmark::State& state)
+{
+    outstream<Sink, Buffering> out;
+    insert_loop<decltype(out), T>(state, out);
+}
+
+template<typename Sink, typename Buffering, typename T>
+void fast_insert(benchmark::State& state)
+{
+    outstream<Sink, Buffering> out;
+    fast_ostream<decltype(out)> fast{out};
+    insert_loop<decltype(fast), T>(state, fast);
+}
+
+}
+
+#define NOVA_FAST_FORMAT(Sink, Buffering)                             \
+    BENCHMARK_TEMPLATE(standard_insert, Sink, Buffering, int);        \
+    BENCHMARK_TEMPLATE(fast_insert, Sink, Buffering, int);            \
+    BENCHMARK_TEMPLATE(standard_insert, Sink, Buffering, double);     \
+    BENCHMARK_TEMPLATE(fast_insert, Sink, Buffering, double);         \
+    BENCHMARK_TEMPLATE(standard_insert, Sink, Buffering, std::string);\
+    BENCHMARK_TEMPLATE(fast_insert, Sink, Buffering, std::string);
+NOVA_FAST_FORMAT(null_sink, buffer_8k)
+NOVA_FAST_FORMAT(null_sink, non_buffered)
+NOVA_FAST_FORMAT(chunk_sink, non_buffered)
@@ -0,0 +1,66 @@
+#include "common.h"
+
+#include <nova/fast_parse.h>
+
+#include <sstream>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* nova::fast_parse against the standard formatted extraction of the same
+ * stream; see formatted.cpp for the std baselines. */
+
+namespace
+{
+
+template<typename T>
+const std::string& text()
+{
+    static const std::string str = []
+    {
+        std::ostringstream out;
+        for (const auto& v : values<T>()) out << v << ' ';
+        return out.str();
+    }();
+    return str;
+}
+
+template<typename Stream, typename T>
+void extract_loop(benchmark::State& state, Stream& in)
+{
+    T value{};
+    for (auto _ : state)
+    {
+        in >> value;
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<typename Source, typename Buffering, typename T>
+void standard_extract(benchmark::State& state)
+{
+    instream<Source, Buffering> in{text<T>()};
+    extract_loop<decltype(in), T>(state, in);
+}
+
+template<typename Source, typename Buffering, typename T>
+void fast_extract(benchmark::State& state)
+{
+    instream<Source, Buffering> in{text<T>()};
+    fast_istream<decltype(in)> fast{in};
+    extract_loop<decltype(fast), T>(state, fast);
+}
+
+}
+
+#define NOVA_FAST_PARSE(Source, Buffering)                               \
+    BENCHMARK_TEMPLATE(standard_extract, Source, Buffering, int);        \
+    BENCHMARK_TEMPLATE(fast_extract, Source, Buffering, int);            \
+    BENCHMARK_TEMPLATE(standard_extract, Source, Buffering, double);     \
+    BENCHMARK_TEMPLATE(fast_extract, Source, Buffering, double);         \
+    BENCHMARK_TEMPLATE(standard_extract, Source, Buffering, std::string);\
+    BENCHMARK_TEMPLATE(fast_extract, Source, Buffering, std::string);
+NOVA_FAST_PARSE(cyclic_provider, non_buffered)
+NOVA_FAST_PARSE(cyclic_source, buffer_8k)
+NOVA_FAST_PARSE(cyclic_source, buffer_16)
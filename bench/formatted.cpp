@@ -0,0 +1,168 @@
+#include "common.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* ns/op of a single formatted insertion or extraction of int, double and
+ * std::string. Every operation also writes (or skips) one separator. */
+
+namespace
+{
+
+constexpr std::size_t value_mask = value_count - 1;
+
+template<typename T>
+const std::string& text()
+{
+    static const std::string str = []
+    {
+        std::ostringstream out;
+        for (const auto& v : values<T>()) out << v << ' ';
+        return out.str();
+    }();
+    return str;
+}
+
+template<typename Stream, typename T>
+void format_loop(benchmark::State& state, Stream& out)
+{
+    const auto& vals = values<T>();
+    std::size_t i = 0;
+    for (auto _ : state) out << vals[i++ & value_mask] << ' ';
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<typename Buffering, typename T>
+void nova_sink_format(benchmark::State& state)
+{
+    outstream<null_sink, Buffering> out;
+    format_loop<decltype(out), T>(state, out);
+}
+
+template<typename T>
+void nova_provider_format(benchmark::State& state)
+{
+    outstream<chunk_sink> out;
+    format_loop<decltype(out), T>(state, out);
+}
+
+template<typename T>
+void std_ostringstream_format(benchmark::State& state)
+{
+    const auto& vals = values<T>();
+    std::ostringstream out;
+    std::size_t i = 0;
+    for (auto _ : state)
+    {
+        /* Rewinding keeps the string from growing without reallocation. */
+        if ((i & value_mask) == 0) out.seekp(0);
+        out << vals[i++ & value_mask] << ' ';
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<typename T>
+void std_ofstream_format(benchmark::State& state)
+{
+    std::ofstream out{"/dev/null"};
+    format_loop<decltype(out), T>(state, out);
+}
+
+inline void print(std::FILE* file, int value) { std::fprintf(file, "%d ", value); }
+inline void print(std::FILE* file, double value) { std::fprintf(file, "%g ", value); }
+inline void print(std::FILE* file, const std::string& value)
+{
+    std::fwrite(value.data(), 1, value.size(), file);
+    std::fputc(' ', file);
+}
+
+template<typename T>
+void fprintf_format(benchmark::State& state)
+{
+    const auto& vals = values<T>();
+    std::FILE* file = std::fopen("/dev/null", "w");
+    std::size_t i = 0;
+    for (auto _ : state) print(file, vals[i++ & value_mask]);
+    std::fclose(file);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<typename Stream, typename T>
+void parse_loop(benchmark::State& state, Stream& in)
+{
+    T value{};
+    for (auto _ : state)
+    {
+        in >> value;
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<typename Buffering, typename T>
+void nova_source_parse(benchmark::State& state)
+{
+    instream<cyclic_source, Buffering> in{text<T>()};
+    parse_loop<decltype(in), T>(state, in);
+}
+
+template<typename T>
+void nova_provider_parse(benchmark::State& state)
+{
+    instream<cyclic_provider> in{text<T>()};
+    parse_loop<decltype(in), T>(state, in);
+}
+
+template<typename T>
+void std_istringstream_parse(benchmark::State& state)
+{
+    std::istringstream in{text<T>()};
+    T value{};
+    for (auto _ : state)
+    {
+        if (!(in >> value))
+        {
+            in.clear();
+            in.seekg(0);
+            in >> value;
+        }
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+}
+
+#define NOVA_SINK_FORMAT(Buffering)                                \
+    BENCHMARK_TEMPLATE(nova_sink_format, Buffering, int);          \
+    BENCHMARK_TEMPLATE(nova_sink_format, Buffering, double);       \
+    BENCHMARK_TEMPLATE(nova_sink_format, Buffering, std::string);
+NOVA_BENCH_ALL_BUFFERINGS(NOVA_SINK_FORMAT)
+BENCHMARK_TEMPLATE(nova_provider_format, int);
+BENCHMARK_TEMPLATE(nova_provider_format, double);
+BENCHMARK_TEMPLATE(nova_provider_format, std::string);
+BENCHMARK_TEMPLATE(std_ostringstream_format, int);
+BENCHMARK_TEMPLATE(std_ostringstream_format, double);
+BENCHMARK_TEMPLATE(std_ostringstream_format, std::string);
+BENCHMARK_TEMPLATE(std_ofstream_format, int);
+BENCHMARK_TEMPLATE(std_ofstream_format, double);
+BENCHMARK_TEMPLATE(std_ofstream_format, std::string);
+BENCHMARK_TEMPLATE(fprintf_format, int);
+BENCHMARK_TEMPLATE(fprintf_format, double);
+BENCHMARK_TEMPLATE(fprintf_format, std::string);
+
+#define NOVA_SOURCE_PARSE(Buffering)                               \
+    BENCHMARK_TEMPLATE(nova_source_parse, Buffering, int);         \
+    BENCHMARK_TEMPLATE(nova_source_parse, Buffering, double);      \
+    BENCHMARK_TEMPLATE(nova_source_parse, Buffering, std::string);
+NOVA_BENCH_ALL_BUFFERINGS(NOVA_SOURCE_PARSE)
+BENCHMARK_TEMPLATE(nova_provider_parse, int);
+BENCHMARK_TEMPLATE(nova_provider_parse, double);
+BENCHMARK_TEMPLATE(nova_provider_parse, std::string);
+BENCHMARK_TEMPLATE(std_istringstream_parse, int);
+BENCHMARK_TEMPLATE(std_istringstream_parse, double);
+BENCHMARK_TEMPLATE(std_istringstream_parse, std::string);
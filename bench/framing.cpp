@@ -0,0 +1,59 @@
+#include "common.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* Length-prefixed messages: 4 byte size followed by a formatted payload. */
+
+namespace
+{
+
+template<typename Out>
+void encode_message(Out& out, int id)
+{
+    out << "id=" << id << " status=ok value=" << id * 3.5 << '\n';
+}
+
+/* Formats into a temporary string to learn the size, then copies it. */
+void nova_frame_via_string(benchmark::State& state)
+{
+    outstream<null_sink, buffer_8k> out;
+    std::ostringstream tmp;
+    int id = 0;
+    for (auto _ : state)
+    {
+        tmp.str(std::string{});
+        encode_message(tmp, ++id);
+        std::string payload = tmp.str();
+        auto size = static_cast<std::uint32_t>(payload.size());
+        out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    }
+    benchmark::DoNotOptimize(out);
+}
+
+/* Formats in place behind a reserved size and fills the size in afterwards. */
+template<typename Buffering>
+void nova_frame_backpatch(benchmark::State& state)
+{
+    outstream<null_sink, Buffering> out;
+    int id = 0;
+    for (auto _ : state)
+    {
+        auto slot = out.reserve(sizeof(std::uint32_t));
+        encode_message(out, ++id);
+        auto size = static_cast<std::uint32_t>(out.tellp() - slot.end());
+        out.backpatch(slot, reinterpret_cast<const char*>(&size));
+    }
+    benchmark::DoNotOptimize(out);
+}
+
+}
+
+BENCHMARK(nova_frame_via_string);
+BENCHMARK_TEMPLATE(nova_frame_backpatch, buffer_8k);
+BENCHMARK_TEMPLATE(nova_frame_backpatch, buffer_32);
@@ -0,0 +1,126 @@
+#include <nova/fd_device.h>
+#include <nova/io_uring_device.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <vector>
+
+using namespace nova;
+
+/* Sequential 64Mb file ingest and output in 256 byte pieces: io_uring
+ * device (and its pread/pwrite fallback) against the 128Kb buffered
+ * file_source/file_sink. syscalls_per_mb counts the system calls made to
+ * move the data. */
+
+namespace
+{
+
+constexpr std::size_t file_size = 64 << 20;
+constexpr const char* file_name = "nstream_bench_uring.tmp";
+constexpr std::size_t piece = 256;
+
+typedef buffering<128 * 1024> buffer_128k;
+
+void make_file()
+{
+    std::vector<char> block(1 << 20, 'x');
+    outstream<file_sink, non_buffered> out{file_name};
+    for (std::size_t done = 0; done < file_size; done += block.size())
+    {
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+}
+
+template<typename Stream>
+void read_all(Stream& in)
+{
+    char block[piece];
+    std::size_t total = 0;
+    while (in.read(block, sizeof(block))) total += sizeof(block);
+    benchmark::DoNotOptimize(total);
+}
+
+template<typename Stream>
+void write_all(Stream& out)
+{
+    std::vector<char> block(piece, 'x');
+    for (std::size_t done = 0; done < file_size; done += block.size())
+    {
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+    out.flush();
+}
+
+void uring_read(benchmark::State& state, bool use_uring)
+{
+    make_file();
+    uring_params params;
+    params.use_uring = use_uring;
+    std::size_t syscalls = 0;
+    for (auto _ : state)
+    {
+        instream<io_uring_source> in{file_name, params};
+        read_all(in);
+        syscalls += in->syscalls();
+    }
+    std::remove(file_name);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+    state.counters["syscalls_per_mb"] = static_cast<double>(syscalls) / state.iterations() / (file_size >> 20);
+}
+
+void file_source_read(benchmark::State& state)
+{
+    make_file();
+    for (auto _ : state)
+    {
+        instream<file_source, buffer_128k> in{file_name};
+        read_all(in);
+    }
+    std::remove(file_name);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+    state.counters["syscalls_per_mb"] = (1 << 20) / buffer_128k::buf_size;
+}
+
+void uring_write(benchmark::State& state, bool use_uring)
+{
+    uring_params params;
+    params.use_uring = use_uring;
+    std::size_t syscalls = 0;
+    for (auto _ : state)
+    {
+        outstream<io_uring_sink> out{file_name, std::ios_base::out, params};
+        write_all(out);
+        out->drain();
+        syscalls += out->syscalls();
+    }
+    std::remove(file_name);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+    state.counters["syscalls_per_mb"] = static_cast<double>(syscalls) / state.iterations() / (file_size >> 20);
+}
+
+void file_sink_write(benchmark::State& state)
+{
+    for (auto _ : state)
+    {
+        outstream<file_sink, buffer_128k> out{file_name};
+        write_all(out);
+    }
+    std::remove(file_name);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * file_size));
+    state.counters["syscalls_per_mb"] = (1 << 20) / buffer_128k::buf_size;
+}
+
+void io_uring_read(benchmark::State& state) { uring_read(state, true); }
+void io_uring_fallback_read(benchmark::State& state) { uring_read(state, false); }
+void io_uring_write(benchmark::State& state) { uring_write(state, true); }
+void io_uring_fallback_write(benchmark::State& state) { uring_write(state, false); }
+
+}
+
+BENCHMARK(io_uring_read)->Unit(benchmark::kMillisecond);
+BENCHMARK(io_uring_fallback_read)->Unit(benchmark::kMillisecond);
+BENCHMARK(file_source_read)->Unit(benchmark::kMillisecond);
+BENCHMARK(io_uring_write)->Unit(benchmark::kMillisecond);
+BENCHMARK(io_uring_fallback_write)->Unit(benchmark::kMillisecond);
+BENCHMARK(file_sink_write)->Unit(benchmark::kMillisecond);
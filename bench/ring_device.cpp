@@ -0,0 +1,80 @@
+#include <nova/ring_device.h>
+#include <nova/fd_device.h>
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace nova;
+
+/* Hand-off of state.range(0) bytes in 4k blocks from a producing thread to
+ * a consuming one: nova::ring_device against a pipe(2) between the same
+ * streams. */
+
+namespace
+{
+
+constexpr std::size_t total = 64 << 20;
+
+template<typename Wait>
+void ring_transfer(benchmark::State& state)
+{
+    std::vector<char> block(4096, 'x');
+    std::vector<char> target(4096);
+    for (auto _ : state)
+    {
+        basic_ring_device<char, Wait> ring{static_cast<std::size_t>(state.range(0))};
+        std::thread producer{[&]
+        {
+            device_outstream<basic_ring_device<char, Wait>> out{ring};
+            for (std::size_t done = 0; done < total; done += block.size())
+            {
+                out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            }
+            out.flush();
+            ring.close();
+        }};
+        device_instream<basic_ring_device<char, Wait>> in{ring};
+        while (in.read(target.data(), static_cast<std::streamsize>(target.size()))) {}
+        producer.join();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(total));
+}
+
+void pipe_transfer(benchmark::State& state)
+{
+    std::vector<char> block(4096, 'x');
+    std::vector<char> target(4096);
+    for (auto _ : state)
+    {
+        int fds[2];
+        if (::pipe(fds) != 0)
+        {
+            state.SkipWithError("pipe failed");
+            return;
+        }
+        std::thread producer{[&]
+        {
+            outstream<file_sink, buffer_4k> out{fds[1], true};
+            for (std::size_t done = 0; done < total; done += block.size())
+            {
+                out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            }
+            out.flush();
+            out->close();
+        }};
+        instream<file_source, buffer_4k> in{fds[0], true};
+        while (in.read(target.data(), static_cast<std::streamsize>(target.size()))) {}
+        producer.join();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(total));
+}
+
+}
+
+BENCHMARK_TEMPLATE(ring_transfer, blocking_wait)->Arg(64 << 10)->Arg(1 << 20)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(ring_transfer, spin_wait)->Arg(64 << 10)->Arg(1 << 20)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(pipe_transfer)->UseRealTime()->Unit(benchmark::kMillisecond);
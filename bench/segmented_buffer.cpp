@@ -0,0 +1,104 @@
+#include <nova/io.h>
+#include <nova/buffer_pool.h>
+#include <nova/segmented_buffer.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+using namespace nova;
+
+namespace
+{
+
+/* Contiguous memory sink doubling its capacity, as buffer_sink in src/sink_buffer.cpp. */
+class doubling_sink
+{
+public:
+    typedef out_buffer_provider category;
+    typedef char char_type;
+
+    std::pair<char_type*, std::size_t> get_out_buffer()
+    {
+        std::size_t capacity = _capacity ? _capacity * 2 : 16 * 1024;
+        std::unique_ptr<char_type[]> buffer{new char_type[capacity]};
+        std::copy(_buffer.get(), _buffer.get() + _capacity, buffer.get());
+        _copied += _capacity;
+        _buffer = std::move(buffer);
+        _size = _capacity;
+        std::swap(_capacity, capacity);
+        return {_buffer.get() + capacity, _capacity - capacity};
+    }
+
+    void flush(std::size_t size) { _size += size; }
+
+    std::size_t copied() const { return _copied; }
+private:
+    std::unique_ptr<char_type[]> _buffer;
+    std::size_t _size = 0;
+    std::size_t _capacity = 0;
+    std::size_t _copied = 0;
+};
+
+/* Writes state.range(0) bytes in 4k blocks into a fresh sink. */
+template<typename Out>
+void fill(Out& out, std::size_t total, const std::vector<char>& block)
+{
+    for (std::size_t done = 0; done < total; done += block.size())
+    {
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+    out.flush();
+}
+
+void doubling_build(benchmark::State& state)
+{
+    auto total = static_cast<std::size_t>(state.range(0));
+    std::vector<char> block(4096, 'x');
+    std::size_t copied = 0;
+    for (auto _ : state)
+    {
+        outstream<doubling_sink> out;
+        fill(out, total, block);
+        copied = out->copied();
+    }
+    state.counters["copied_mb"] = static_cast<double>(copied) / (1 << 20);
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template<typename Allocator>
+void segmented_build(benchmark::State& state)
+{
+    auto total = static_cast<std::size_t>(state.range(0));
+    std::vector<char> block(4096, 'x');
+    for (auto _ : state)
+    {
+        outstream<basic_segmented_buffer_sink<char, Allocator>> out{std::size_t{64 * 1024}};
+        fill(out, total, block);
+        benchmark::DoNotOptimize(out->size());
+    }
+    state.counters["copied_mb"] = 0;
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void segmented_read_back(benchmark::State& state)
+{
+    auto total = static_cast<std::size_t>(state.range(0));
+    std::vector<char> block(4096, 'x');
+    outstream<segmented_buffer_sink> out{std::size_t{64 * 1024}};
+    fill(out, total, block);
+    for (auto _ : state)
+    {
+        instream<segmented_buffer_source> in{*out};
+        while (in.read(block.data(), static_cast<std::streamsize>(block.size()))) {}
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+BENCHMARK(doubling_build)->Arg(1 << 20)->Arg(64 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(segmented_build, std::allocator<char>)->Arg(1 << 20)->Arg(64 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(segmented_build, pool_allocator<char>)->Arg(1 << 20)->Arg(64 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK(segmented_read_back)->Arg(1 << 20)->Arg(64 << 20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,58 @@
+#include "common.h"
+
+#include <nova/shared_outstream.h>
+
+#include <memory>
+#include <mutex>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* Many threads writing short log records (~40 characters) to one sink:
+ * nova::shared_outstream against a single buffered outstream guarded by a
+ * mutex. The time is per record per thread (real time), the items rate is
+ * the total over all threads. */
+
+namespace
+{
+
+std::unique_ptr<shared_outstream<null_sink>> shared_log;
+
+void shared_records(benchmark::State& state)
+{
+    if (state.thread_index() == 0) shared_log = std::make_unique<shared_outstream<null_sink>>();
+    int id = state.thread_index();
+    int i = 0;
+    for (auto _ : state)
+    {
+        shared_log->record() << "thread " << id << " record " << i++ << " value " << 3.25 << '\n';
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0)
+    {
+        shared_log->drain();
+        shared_log.reset();
+    }
+}
+
+std::unique_ptr<outstream<null_sink, buffer_8k>> locked_log;
+std::mutex locked_mutex;
+
+void locked_records(benchmark::State& state)
+{
+    if (state.thread_index() == 0) locked_log = std::make_unique<outstream<null_sink, buffer_8k>>();
+    int id = state.thread_index();
+    int i = 0;
+    for (auto _ : state)
+    {
+        std::lock_guard<std::mutex> lock{locked_mutex};
+        *locked_log << "thread " << id << " record " << i++ << " value " << 3.25 << '\n';
+    }
+    state.SetItemsProcessed(state.iterations());
+    if (state.thread_index() == 0) locked_log.reset();
+}
+
+}
+
+BENCHMARK(shared_records)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
+BENCHMARK(locked_records)->Threads(1)->Threads(4)->Threads(16)->Threads(64)->UseRealTime();
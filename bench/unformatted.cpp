@@ -0,0 +1,138 @@
+#include "common.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace nova;
+using namespace nova_bench;
+
+/* Throughput of unformatted write()/read() of small blocks (state.range(0)
+ * characters) where the stream buffering matters most. */
+
+namespace
+{
+
+const std::string& block_text()
+{
+    static const std::string str(64 * 1024, 'x');
+    return str;
+}
+
+template<typename Stream>
+void write_loop(benchmark::State& state, Stream& out)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    for (auto _ : state) out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template<typename Buffering>
+void nova_sink_write(benchmark::State& state)
+{
+    outstream<null_sink, Buffering> out;
+    write_loop(state, out);
+}
+
+void nova_provider_write_block(benchmark::State& state)
+{
+    outstream<chunk_sink> out;
+    write_loop(state, out);
+}
+
+void std_ostringstream_write_block(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    std::ostringstream out;
+    std::size_t written = 0;
+    for (auto _ : state)
+    {
+        if (written > (1 << 20))
+        {
+            out.seekp(0);
+            written = 0;
+        }
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+        written += block.size();
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void std_ofstream_write_block(benchmark::State& state)
+{
+    std::ofstream out{"/dev/null"};
+    write_loop(state, out);
+}
+
+void fwrite_block(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)), 'x');
+    std::FILE* file = std::fopen("/dev/null", "w");
+    for (auto _ : state) std::fwrite(block.data(), 1, block.size(), file);
+    std::fclose(file);
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template<typename Stream>
+void read_loop(benchmark::State& state, Stream& in)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)));
+    for (auto _ : state)
+    {
+        in.read(block.data(), static_cast<std::streamsize>(block.size()));
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+template<typename Buffering>
+void nova_source_read(benchmark::State& state)
+{
+    instream<cyclic_source, Buffering> in{block_text()};
+    read_loop(state, in);
+}
+
+void nova_provider_read_block(benchmark::State& state)
+{
+    instream<cyclic_provider> in{block_text()};
+    read_loop(state, in);
+}
+
+void std_istringstream_read_block(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)));
+    std::istringstream in{block_text()};
+    for (auto _ : state)
+    {
+        if (!in.read(block.data(), static_cast<std::streamsize>(block.size())))
+        {
+            in.clear();
+            in.seekg(0);
+        }
+        benchmark::DoNotOptimize(block.data());
+    }
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+void fread_block(benchmark::State& state)
+{
+    std::vector<char> block(static_cast<std::size_t>(state.range(0)));
+    std::FILE* file = std::fopen("/dev/zero", "r");
+    for (auto _ : state) benchmark::DoNotOptimize(std::fread(block.data(), 1, block.size(), file));
+    std::fclose(file);
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+
+}
+
+#define NOVA_SINK_WRITE(Buffering) BENCHMARK_TEMPLATE(nova_sink_write, Buffering)->Arg(16)->Arg(256);
+#define NOVA_SOURCE_READ(Buffering) BENCHMARK_TEMPLATE(nova_source_read, Buffering)->Arg(16)->Arg(256);
+NOVA_BENCH_ALL_BUFFERINGS(NOVA_SINK_WRITE)
+BENCHMARK(nova_provider_write_block)->Arg(16)->Arg(256);
+BENCHMARK(std_ostringstream_write_block)->Arg(16)->Arg(256);
+BENCHMARK(std_ofstream_write_block)->Arg(16)->Arg(256);
+BENCHMARK(fwrite_block)->Arg(16)->Arg(256);
+NOVA_BENCH_ALL_BUFFERINGS(NOVA_SOURCE_READ)
+BENCHMARK(nova_provider_read_block)->Arg(16)->Arg(256);
+BENCHMARK(std_istringstream_read_block)->Arg(16)->Arg(256);
+BENCHMARK(fread_block)->Arg(16)->Arg(256);
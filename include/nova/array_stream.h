@@ -0,0 +1,291 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_ARRAY_STREAM_H
+#define NOVA_ARRAY_STREAM_H
+
+#include <nova/io.h>
+
+#include <limits>
+#include <memory>
+#include <string_view>
+
+/**
+ * @file array_stream.h
+ * @brief Output streams formatting into a fixed size character array.
+ *
+ * Neither the stream nor its buffer is allocated: the characters go to an
+ * array inside the stream object (nova::array_outstream) or to the one
+ * provided by the caller (nova::span_outstream).
+ *
+ * ~~~~~{.cpp}
+ * nova::array_outstream<64> key;
+ * key << "user:" << id << ':' << field;
+ * lookup(key.view());
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Overflow policy of the array streams: characters which do not fit are
+ * dropped, the stream stays good and <code>truncated()</code> is set.
+ */
+struct overflow_truncate {};
+/**
+ * Overflow policy of the array streams: a write which does not fit sets
+ * <code>badbit</code>, the characters which fit are kept.
+ */
+struct overflow_fail {};
+/**
+ * Overflow policy of the array streams: when the array is full the content
+ * moves to a heap buffer which grows as needed.
+ */
+struct overflow_spill {};
+
+/**
+ * Stream buffer writing into a character array.
+ *
+ * @tparam CharT character type
+ * @tparam Overflow overflow policy: nova::overflow_truncate,
+ *                  nova::overflow_fail or nova::overflow_spill
+ * @tparam Traits character traits type
+ */
+template<typename CharT, typename Overflow = overflow_truncate, typename Traits = std::char_traits<CharT>>
+class basic_array_outbuf : public std::basic_streambuf<CharT, Traits>
+{
+    typedef std::basic_streambuf<CharT, Traits> _buf_type;
+public:
+    typedef CharT                                 char_type;
+    typedef Traits                                traits_type;
+    typedef typename Traits::int_type             int_type;
+    typedef typename Traits::pos_type             pos_type;
+    typedef typename Traits::off_type             off_type;
+    typedef std::basic_string_view<CharT, Traits> string_view_type;
+
+    /**
+     * @param s array to write to
+     * @param n size of the array
+     */
+    basic_array_outbuf(char_type* s, std::size_t n) : _array{s}, _capacity{n} { _buf_type::setp(s, s + n); }
+
+    basic_array_outbuf(const basic_array_outbuf& ) = delete;
+    basic_array_outbuf& operator=(const basic_array_outbuf& ) = delete;
+
+    /**
+     * @return the characters written.
+     */
+    string_view_type view() const
+    {
+        return {_buf_type::pbase(), static_cast<std::size_t>(_buf_type::pptr() - _buf_type::pbase())};
+    }
+
+    /**
+     * @return <code>true</code> if characters were dropped
+     *         (nova::overflow_truncate) or not written (nova::overflow_fail).
+     */
+    bool truncated() const { return _truncated; }
+    /**
+     * @return <code>true</code> if the content moved to the heap
+     *         (nova::overflow_spill).
+     */
+    bool spilled() const { return _spill != nullptr; }
+
+    /**
+     * Discards the content and starts writing at the beginning of the
+     * array again.
+     */
+    void clear()
+    {
+        _spill.reset();
+        _truncated = false;
+        _buf_type::setp(_array, _array + _capacity);
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof())) return traits_type::not_eof(ch);
+        char_type c = traits_type::to_char_type(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+    std::streamsize xsputn(const char_type* s, std::streamsize n) override
+    {
+        auto size = static_cast<std::size_t>(n);
+        auto avail = static_cast<std::size_t>(_buf_type::epptr() - _buf_type::pptr());
+        if (size > avail && !grow(size - avail, Overflow{}))
+        {
+            _truncated = true;
+            traits_type::copy(_buf_type::pptr(), s, avail);
+            advance(avail);
+            return std::is_same<Overflow, overflow_fail>::value ? static_cast<std::streamsize>(avail) : n;
+        }
+        traits_type::copy(_buf_type::pptr(), s, size);
+        advance(size);
+        return n;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        /* Only the current position is reported: tellp. */
+        if (!(which & std::ios_base::out) || dir != std::ios_base::cur || off != 0) return pos_type(off_type(-1));
+        return pos_type(off_type(_buf_type::pptr() - _buf_type::pbase()));
+    }
+
+private:
+    bool grow(std::size_t , overflow_truncate) { return false; }
+    bool grow(std::size_t , overflow_fail) { return false; }
+    bool grow(std::size_t more, overflow_spill)
+    {
+        std::size_t size = static_cast<std::size_t>(_buf_type::pptr() - _buf_type::pbase());
+        std::size_t capacity = static_cast<std::size_t>(_buf_type::epptr() - _buf_type::pbase());
+        capacity = std::max(capacity * 2, size + more);
+        std::unique_ptr<char_type[]> spill{new char_type[capacity]};
+        traits_type::copy(spill.get(), _buf_type::pbase(), size);
+        _spill = std::move(spill);
+        _buf_type::setp(_spill.get(), _spill.get() + capacity);
+        advance(size);
+        return true;
+    }
+
+    void advance(std::size_t n)
+    {
+        /* pbump takes int */
+        while (n > static_cast<std::size_t>(std::numeric_limits<int>::max()))
+        {
+            _buf_type::pbump(std::numeric_limits<int>::max());
+            n -= static_cast<std::size_t>(std::numeric_limits<int>::max());
+        }
+        _buf_type::pbump(static_cast<int>(n));
+    }
+
+    char_type* _array;
+    std::size_t _capacity;
+    std::unique_ptr<char_type[]> _spill;
+    bool _truncated = false;
+};
+
+/* Base-from-member: the buffer has to be constructed before basic_ostream. */
+template<typename CharT, typename Overflow, typename Traits>
+struct _array_outbuf_holder
+{
+    _array_outbuf_holder(CharT* s, std::size_t n) : _outbuf{s, n} {}
+
+    basic_array_outbuf<CharT, Overflow, Traits> _outbuf;
+};
+
+template<std::size_t N, typename CharT>
+struct _array_holder
+{
+    CharT _array[N];
+};
+
+/**
+ * Output stream writing into a character array provided by the caller.
+ *
+ * The stream allocates nothing (unless nova::overflow_spill policy kicks
+ * in); the result is available as <code>view()</code>.
+ *
+ * @tparam CharT character type
+ * @tparam Overflow overflow policy: nova::overflow_truncate,
+ *                  nova::overflow_fail or nova::overflow_spill
+ * @tparam Traits character traits type
+ */
+template<typename CharT, typename Overflow = overflow_truncate, typename Traits = std::char_traits<CharT>>
+class basic_span_outstream : private _array_outbuf_holder<CharT, Overflow, Traits>,
+                             public std::basic_ostream<CharT, Traits>
+{
+    typedef _array_outbuf_holder<CharT, Overflow, Traits> _holder_type;
+    typedef std::basic_ostream<CharT, Traits>             _ostream_type;
+public:
+    typedef CharT                                 char_type;
+    typedef Traits                                traits_type;
+    typedef std::basic_string_view<CharT, Traits> string_view_type;
+
+    /**
+     * @param s array to write to
+     * @param n size of the array
+     */
+    basic_span_outstream(char_type* s, std::size_t n) : _holder_type{s, n}, _ostream_type{&this->_outbuf} {}
+    /**
+     * @param array array to write to
+     */
+    template<std::size_t N>
+    explicit basic_span_outstream(char_type (&array)[N]) : basic_span_outstream{array, N} {}
+
+    basic_span_outstream(const basic_span_outstream& ) = delete;
+    basic_span_outstream& operator=(const basic_span_outstream& ) = delete;
+
+    /**
+     * @return the characters written.
+     */
+    string_view_type view() const { return this->_outbuf.view(); }
+    /**
+     * @return number of characters written.
+     */
+    std::size_t size() const { return view().size(); }
+    /**
+     * @return <code>true</code> if characters did not fit.
+     */
+    bool truncated() const { return this->_outbuf.truncated(); }
+    /**
+     * @return <code>true</code> if the content moved to the heap.
+     */
+    bool spilled() const { return this->_outbuf.spilled(); }
+
+    /**
+     * Discards the content and the stream state.
+     */
+    void reset()
+    {
+        this->_outbuf.clear();
+        _ostream_type::clear();
+    }
+};
+
+/**
+ * Output stream writing into a character array of <code>N</code>
+ * characters inside the stream object, e.g. on the stack.
+ *
+ * @tparam N capacity in characters
+ * @tparam CharT character type
+ * @tparam Overflow overflow policy: nova::overflow_truncate,
+ *                  nova::overflow_fail or nova::overflow_spill
+ * @tparam Traits character traits type
+ *
+ * @see basic_span_outstream
+ */
+template<std::size_t N, typename CharT = char, typename Overflow = overflow_truncate,
+         typename Traits = std::char_traits<CharT>>
+class basic_array_outstream : private _array_holder<N, CharT>,
+                              public basic_span_outstream<CharT, Overflow, Traits>
+{
+public:
+    basic_array_outstream() : basic_span_outstream<CharT, Overflow, Traits>{this->_array, N} {}
+
+    /**
+     * @return capacity of the array.
+     */
+    static constexpr std::size_t capacity() { return N; }
+};
+
+/**
+ * Type definition for <code>char</code> stream writing into its own array.
+ */
+template<std::size_t N, typename Overflow = overflow_truncate>
+using array_outstream = basic_array_outstream<N, char, Overflow>;
+
+/**
+ * Type definition for <code>char</code> stream writing into the caller's
+ * array with nova::overflow_truncate policy.
+ */
+typedef basic_span_outstream<char> span_outstream;
+
+} // end of nova namespace
+
+#endif // NOVA_ARRAY_STREAM_H
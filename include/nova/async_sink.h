@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_ASYNC_SINK_H
+#define NOVA_ASYNC_SINK_H
+
+#include <nova/io.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @file async_sink.h
+ * @brief Output buffer provider writing to the sink on a background thread.
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<nova::async_sink<nova::file_sink>> out{"data.log"};
+ * out << "written by the background thread\n";
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Parameters of nova::async_sink.
+ */
+struct async_params
+{
+    /**
+     * Size of each buffer in characters.
+     */
+    std::size_t buffer_size = 64 * 1024;
+    /**
+     * Number of buffers. When all of them are waiting for the writer thread
+     * the producing thread blocks until one is written.
+     */
+    std::size_t buffers = 4;
+};
+
+/**
+ * Output buffer provider which hands filled buffers to a dedicated writer
+ * thread calling <code>Sink::write</code> and <code>Sink::flush</code>, so
+ * the thread producing the output never waits for the device unless all
+ * the buffers are in flight.
+ *
+ * Flushing the stream passes whatever is written so far to the writer
+ * thread, which writes it and flushes <code>Sink</code>; it does not wait
+ * for that to happen. <code>drain</code> waits until everything passed to
+ * the writer thread is written; <code>close</code> (called on destruction)
+ * drains and stops the thread. The stream should be flushed before
+ * <code>close</code>.
+ *
+ * If <code>Sink</code> fails to write, the rest of the data is discarded
+ * and the stream gets no more buffers.
+ *
+ * @tparam Sink sink to write to, nova::sink
+ */
+template<typename Sink>
+class async_sink
+{
+    static_assert(std::is_same<typename Sink::category, nova::sink>::value, "async_sink requires nova::sink");
+public:
+    typedef typename Sink::char_type char_type;
+    typedef out_buffer_provider      category;
+
+    /**
+     * Constructor with default parameters.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template<typename... Args>
+    explicit async_sink(Args&&... args) : _sink{std::forward<Args>(args)...} { start(); }
+
+    /**
+     * Constructor.
+     *
+     * @param params buffer parameters
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template<typename... Args>
+    explicit async_sink(async_params params, Args&&... args) :
+            _sink{std::forward<Args>(args)...}, _params{params} { start(); }
+
+    async_sink(const async_sink& ) = delete;
+    async_sink& operator=(const async_sink& ) = delete;
+
+    ~async_sink() noexcept { close(); }
+
+    /* out_buffer_provider functions */
+    std::pair<char_type*, std::size_t> get_out_buffer()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        /* The stream only asks for the next buffer when the previous one is full. */
+        if (_current) submit({_current, _begin, _params.buffer_size - _begin, false, true});
+        _current = nullptr;
+        _free_cond.wait(lock, [this] { return !_free.empty() || _failed; });
+        if (_failed) return {nullptr, 0};
+        _current = _free.back();
+        _free.pop_back();
+        _begin = 0;
+        return {_current, _params.buffer_size};
+    }
+
+    void flush(std::size_t size)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        if (!_writer.joinable()) return;
+        submit({_current, _begin, size, true, false});
+        _begin += size;
+    }
+
+    /**
+     * Waits until the writer thread has written everything passed to it.
+     */
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        _drained_cond.wait(lock, [this] { return _pending == 0; });
+    }
+
+    /**
+     * Drains and stops the writer thread. Nothing can be written afterwards.
+     * Called automatically on destruction.
+     */
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if (!_writer.joinable()) return;
+            if (_current) submit({_current, 0, 0, false, true});
+            _current = nullptr;
+            _stop = true;
+        }
+        _queue_cond.notify_one();
+        _writer.join();
+    }
+
+    /**
+     * @return <code>false</code> if the sink failed to write.
+     */
+    bool good() const
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        return !_failed;
+    }
+
+    /**
+     * Provides access to the wrapped sink. It is used by the writer thread
+     * until <code>close</code> is called.
+     *
+     * @return reference to the wrapped sink.
+     */
+    Sink& sink() { return _sink; }
+    /**
+     * @return const reference to the wrapped sink.
+     */
+    const Sink& sink() const { return _sink; }
+
+private:
+    struct job
+    {
+        char_type* buffer;
+        std::size_t offset;
+        std::size_t size;
+        bool flush;
+        bool release;
+    };
+
+    void start()
+    {
+        if (_params.buffer_size == 0) _params.buffer_size = 1;
+        if (_params.buffers == 0) _params.buffers = 1;
+        _storage.reset(new char_type[_params.buffer_size * _params.buffers]);
+        for (std::size_t i = 0; i < _params.buffers; ++i) _free.push_back(_storage.get() + i * _params.buffer_size);
+        _writer = std::thread{[this] { run(); }};
+    }
+
+    /* Called with the mutex locked. */
+    void submit(const job& j)
+    {
+        _queue.push_back(j);
+        ++_pending;
+        _queue_cond.notify_one();
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        for (;;)
+        {
+            _queue_cond.wait(lock, [this] { return _stop || !_queue.empty(); });
+            if (_queue.empty()) return;
+            job j = _queue.front();
+            _queue.pop_front();
+            bool failed = _failed;
+            lock.unlock();
+            if (!failed && j.size > 0)
+            {
+                auto size = static_cast<std::streamsize>(j.size);
+                failed = _sink.write(j.buffer + j.offset, size) < size;
+            }
+            if (!failed && j.flush) _sink.flush();
+            lock.lock();
+            if (failed && !_failed)
+            {
+                _failed = true;
+                _free_cond.notify_all();
+            }
+            if (j.release)
+            {
+                _free.push_back(j.buffer);
+                _free_cond.notify_one();
+            }
+            if (--_pending == 0) _drained_cond.notify_all();
+        }
+    }
+
+    Sink _sink;
+    async_params _params;
+    std::unique_ptr<char_type[]> _storage;
+    std::vector<char_type*> _free;
+    std::deque<job> _queue;
+    std::size_t _pending = 0;
+    char_type* _current = nullptr;
+    std::size_t _begin = 0;
+    bool _stop = false;
+    bool _failed = false;
+    mutable std::mutex _mutex;
+    std::condition_variable _queue_cond;
+    std::condition_variable _free_cond;
+    std::condition_variable _drained_cond;
+    std::thread _writer;
+};
+
+} // end of nova namespace
+
+#endif // NOVA_ASYNC_SINK_H
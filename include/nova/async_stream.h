@@ -0,0 +1,744 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_ASYNC_STREAM_H
+#define NOVA_ASYNC_STREAM_H
+
+#include <nova/io.h>
+
+#if !defined(__cpp_impl_coroutine)
+#error "nova/async_stream.h requires C++20 coroutines"
+#endif
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @file async_stream.h
+ * @brief Coroutine based asynchronous input and output streams.
+ *
+ * nova::async_instream and nova::async_outstream are the asynchronous
+ * counterparts of nova::instream and nova::outstream: instead of blocking in
+ * <code>Source::read</code> and <code>Sink::write</code> they await the
+ * source and the sink, so a single thread can serve thousands of streams.
+ *
+ * ~~~~~{.cpp}
+ * nova::task<> echo(nova::async_device_instream<nova::async_fd> in,
+ *                   nova::async_device_outstream<nova::async_fd> out)
+ * {
+ *     std::string line;
+ *     while (co_await in.read_line(line))
+ *     {
+ *         co_await out.write(line);
+ *         co_await out.flush();
+ *     }
+ * }
+ * ~~~~~
+ *
+ * The coroutines run on nova::executor, a single-threaded run queue;
+ * nova::epoll_reactor (nova/epoll_reactor.h) adds readiness notification
+ * for file descriptors.
+ *
+ * Requires C++20.
+ */
+
+namespace nova {
+
+/**
+ * Awaitable source tag.
+ *
+ * This tag is used to indicate that this object can be used as a source
+ * for nova::async_instream. The object with this tag is expected to have
+ * the following type definitions:
+ *
+ * ~~~~~{.cpp}
+ * typedef <character type> char_type;
+ * typedef awaitable_source category;
+ * ~~~~~
+ *
+ * and the following method:
+ *
+ * ~~~~~{.cpp}
+ * <awaitable of std::size_t> read_some(char_type* s, std::size_t n);
+ * ~~~~~
+ *
+ * The awaitable completes with the number of characters read, at least
+ * one unless the end of data is reached or the source failed, in which
+ * case it is 0.
+ */
+struct awaitable_source {};
+/**
+ * Awaitable sink tag.
+ *
+ * This tag is used to indicate that this object can be used as a sink
+ * for nova::async_outstream. The object with this tag is expected to have
+ * the following type definitions:
+ *
+ * ~~~~~{.cpp}
+ * typedef <character type> char_type;
+ * typedef awaitable_sink category;
+ * ~~~~~
+ *
+ * and the following methods:
+ *
+ * ~~~~~{.cpp}
+ * <awaitable of std::size_t> write_some(const char_type* s, std::size_t n);
+ * <awaitable> flush();
+ * ~~~~~
+ *
+ * The awaitable of <code>write_some</code> completes with the number of
+ * characters written, at least one unless the sink failed, in which case it
+ * is 0.
+ */
+struct awaitable_sink {};
+
+template<typename T = void>
+class task;
+
+template<typename T>
+class _task_promise_base
+{
+public:
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    auto final_suspend() noexcept
+    {
+        /* Resumes the awaiting coroutine without growing the stack. */
+        struct final_awaiter
+        {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<typename task<T>::promise_type> h) noexcept
+            {
+                return h.promise()._continuation;
+            }
+            void await_resume() noexcept {}
+        };
+        return final_awaiter{};
+    }
+
+    void unhandled_exception() noexcept { _exception = std::current_exception(); }
+
+    std::coroutine_handle<> _continuation = std::noop_coroutine();
+    std::exception_ptr _exception;
+};
+
+template<typename T>
+class _task_promise : public _task_promise_base<T>
+{
+public:
+    void return_value(T value) { _value.emplace(std::move(value)); }
+
+    T result()
+    {
+        if (this->_exception) std::rethrow_exception(this->_exception);
+        return std::move(*_value);
+    }
+
+private:
+    std::optional<T> _value;
+};
+
+template<>
+class _task_promise<void> : public _task_promise_base<void>
+{
+public:
+    void return_void() noexcept {}
+
+    void result()
+    {
+        if (_exception) std::rethrow_exception(_exception);
+    }
+};
+
+/**
+ * Lazily started coroutine producing a value of type <code>T</code>.
+ *
+ * The coroutine starts when the task is awaited and resumes the awaiting
+ * coroutine when it finishes. Exceptions are rethrown to the awaiting
+ * coroutine.
+ *
+ * @tparam T type of the result
+ */
+template<typename T>
+class task
+{
+public:
+    struct promise_type : _task_promise<T>
+    {
+        task get_return_object() { return task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+    };
+
+    task(task&& other) noexcept : _handle{std::exchange(other._handle, nullptr)} {}
+    task(const task& ) = delete;
+    task& operator=(const task& ) = delete;
+    task& operator=(task&& other) noexcept
+    {
+        std::swap(_handle, other._handle);
+        return *this;
+    }
+
+    ~task() noexcept { if (_handle) _handle.destroy(); }
+
+    bool await_ready() const noexcept { return !_handle || _handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        _handle.promise()._continuation = awaiting;
+        return _handle;
+    }
+    T await_resume() { return _handle.promise().result(); }
+
+private:
+    explicit task(std::coroutine_handle<promise_type> handle) : _handle{handle} {}
+
+    std::coroutine_handle<promise_type> _handle;
+};
+
+/**
+ * Single-threaded executor: a queue of coroutines ready to run.
+ *
+ * Tasks started with <code>spawn</code> are owned by the executor and run
+ * by <code>run</code>. An exception escaping a spawned task terminates the
+ * program.
+ */
+class executor
+{
+public:
+    executor() = default;
+    executor(const executor& ) = delete;
+    executor& operator=(const executor& ) = delete;
+
+    /**
+     * Starts the task on this executor.
+     *
+     * @param t task to run
+     */
+    void spawn(task<> t)
+    {
+        ++_alive;
+        post(run_detached(std::move(t))._handle);
+    }
+
+    /**
+     * Queues a suspended coroutine to be resumed by <code>run</code>.
+     */
+    void post(std::coroutine_handle<> handle) { _ready.push_back(handle); }
+
+    /**
+     * Runs queued coroutines until the queue is empty.
+     *
+     * @return number of coroutines resumed.
+     */
+    std::size_t run()
+    {
+        std::size_t count = 0;
+        while (!_ready.empty())
+        {
+            auto handle = _ready.front();
+            _ready.pop_front();
+            handle.resume();
+            ++count;
+        }
+        return count;
+    }
+
+    /**
+     * @return number of spawned tasks which have not finished yet.
+     */
+    std::size_t alive() const { return _alive; }
+
+    /**
+     * @return awaitable which requeues the awaiting coroutine, letting the
+     *         other ready coroutines run.
+     */
+    auto schedule()
+    {
+        struct awaiter
+        {
+            executor& ex;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { ex.post(h); }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this};
+    }
+
+private:
+    struct detached
+    {
+        struct promise_type
+        {
+            detached get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    detached run_detached(task<> t)
+    {
+        co_await t;
+        --_alive;
+    }
+
+    std::deque<std::coroutine_handle<>> _ready;
+    std::size_t _alive = 0;
+};
+
+/**
+ * Asynchronous input stream.
+ *
+ * Reads are served from the stream buffer when it has data, without
+ * suspending; otherwise the stream awaits <code>Source::read_some</code>.
+ * Reads which are at least as large as the buffer go directly to the
+ * source.
+ *
+ * @tparam Source source with nova::awaitable_source category
+ * @tparam Buffering buffer size, e.g. nova::buffer_4k or nova::dynamic_buffering
+ */
+template<typename Source, typename Buffering = non_buffered>
+class async_instream
+{
+    static_assert(std::is_same<typename Source::category, awaitable_source>::value,
+                  "async_instream requires awaitable_source");
+public:
+    typedef typename Source::char_type   char_type;
+    typedef std::char_traits<char_type> traits_type;
+
+    /**
+     * Main constructor.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Source</code>
+     */
+    template<class... Args>
+    explicit async_instream(Args&&... args) : _source{std::forward<Args>(args)...} { allocate(); }
+    /**
+     * Constructor with buffering policy.
+     *
+     * @param buffering buffering policy object
+     * @param args Arguments to be forwarded to construct the <code>Source</code>
+     */
+    template<class... Args>
+    explicit async_instream(Buffering buffering, Args&&... args) :
+            _source{std::forward<Args>(args)...}, _buffering{buffering} { allocate(); }
+
+    async_instream(async_instream&& ) = default;
+    async_instream(const async_instream& ) = delete;
+    async_instream& operator=(const async_instream& ) = delete;
+
+    Source& operator*() { return _source; }
+    Source* operator->() { return &_source; }
+    const Source& operator*() const { return _source; }
+    const Source* operator->() const { return &_source; }
+
+    /**
+     * Reads available characters, suspending only if the buffer is empty.
+     *
+     * @param s destination
+     * @param n maximum number of characters to read
+     * @return awaitable of the number of characters read, 0 at the end of data.
+     */
+    auto read_some(char_type* s, std::size_t n) { return read_awaiter{*this, s, n}; }
+    /**
+     * @param s destination span
+     * @return awaitable of the number of characters read, 0 at the end of data.
+     */
+    auto read_some(std::span<char_type> s) { return read_some(s.data(), s.size()); }
+
+    /**
+     * Reads exactly <code>n</code> characters unless the end of data is
+     * reached first, which sets the failed state.
+     *
+     * @param s destination
+     * @param n number of characters to read
+     * @return number of characters read.
+     */
+    task<std::size_t> read(char_type* s, std::size_t n)
+    {
+        std::size_t done = 0;
+        while (done < n)
+        {
+            std::size_t got = co_await read_some(s + done, n - done);
+            if (got == 0)
+            {
+                _fail = true;
+                break;
+            }
+            done += got;
+        }
+        co_return done;
+    }
+    /**
+     * @param s destination span
+     * @return number of characters read.
+     */
+    task<std::size_t> read(std::span<char_type> s) { return read(s.data(), s.size()); }
+
+    /**
+     * Reads characters up to the delimiter, which is extracted but not
+     * stored. The last line does not need the delimiter.
+     *
+     * @param line string receiving the line
+     * @param delim delimiter
+     * @return <code>true</code> if a line was read, <code>false</code> at the end of data.
+     */
+    task<bool> read_line(std::basic_string<char_type>& line, char_type delim = char_type('\n'))
+    {
+        line.clear();
+        bool any = false;
+        for (;;)
+        {
+            if (_begin == _end)
+            {
+                if (_capacity == 0)
+                {
+                    char_type ch;
+                    std::size_t got = co_await read_some(&ch, 1);
+                    if (got == 0) break;
+                    any = true;
+                    if (traits_type::eq(ch, delim)) co_return true;
+                    line.push_back(ch);
+                    continue;
+                }
+                std::size_t got = co_await fill();
+                if (got == 0) break;
+            }
+            any = true;
+            const char_type* first = _buffer.get() + _begin;
+            const char_type* found = traits_type::find(first, _end - _begin, delim);
+            std::size_t len = found ? static_cast<std::size_t>(found - first) : _end - _begin;
+            line.append(first, len);
+            _begin += len;
+            if (found)
+            {
+                ++_begin;
+                co_return true;
+            }
+        }
+        if (!any) _fail = true;
+        co_return any;
+    }
+
+    /**
+     * @return <code>true</code> if the end of data has been reached.
+     */
+    bool eof() const { return _eof; }
+    /**
+     * @return <code>true</code> if a read could not be completed.
+     */
+    bool fail() const { return _fail; }
+    explicit operator bool() const { return !_fail; }
+    bool operator!() const { return _fail; }
+
+private:
+    class read_awaiter
+    {
+    public:
+        read_awaiter(async_instream& in, char_type* s, std::size_t n) : _in{in}, _s{s}, _n{n} {}
+
+        bool await_ready()
+        {
+            if (_in._begin == _in._end && _n > 0) return false;
+            _result = _in.take(_s, _n);
+            return true;
+        }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+        {
+            _slow.emplace(_in.read_source(_s, _n));
+            return _slow->await_suspend(h);
+        }
+        std::size_t await_resume() { return _slow ? _slow->await_resume() : _result; }
+
+    private:
+        async_instream& _in;
+        char_type* _s;
+        std::size_t _n;
+        std::size_t _result = 0;
+        std::optional<task<std::size_t>> _slow;
+    };
+
+    void allocate()
+    {
+        _capacity = _buffering.size();
+        if (_capacity > 0) _buffer.reset(new char_type[_capacity]);
+    }
+
+    std::size_t take(char_type* s, std::size_t n)
+    {
+        std::size_t len = std::min(n, _end - _begin);
+        traits_type::copy(s, _buffer.get() + _begin, len);
+        _begin += len;
+        return len;
+    }
+
+    task<std::size_t> fill()
+    {
+        if (_eof) co_return 0;
+        std::size_t got = co_await _source.read_some(_buffer.get(), _capacity);
+        if (got == 0) _eof = true;
+        _begin = 0;
+        _end = got;
+        co_return got;
+    }
+
+    task<std::size_t> read_source(char_type* s, std::size_t n)
+    {
+        if (_eof) co_return 0;
+        if (n >= _capacity)
+        {
+            std::size_t got = co_await _source.read_some(s, n);
+            if (got == 0) _eof = true;
+            co_return got;
+        }
+        co_await fill();
+        co_return take(s, n);
+    }
+
+    Source _source;
+    Buffering _buffering;
+    std::unique_ptr<char_type[]> _buffer;
+    std::size_t _capacity = 0;
+    std::size_t _begin = 0;
+    std::size_t _end = 0;
+    bool _eof = false;
+    bool _fail = false;
+};
+
+/**
+ * Asynchronous output stream.
+ *
+ * Writes which fit into the stream buffer complete without suspending;
+ * otherwise the stream awaits <code>Sink::write_some</code> until the
+ * buffer and the data are written. Writes which are at least as large as the
+ * buffer go directly to the sink.
+ *
+ * The stream cannot await in its destructor: it must be flushed with
+ * <code>co_await flush()</code>, characters left in the buffer are lost.
+ *
+ * @tparam Sink sink with nova::awaitable_sink category
+ * @tparam Buffering buffer size, e.g. nova::buffer_4k or nova::dynamic_buffering
+ */
+template<typename Sink, typename Buffering = non_buffered>
+class async_outstream
+{
+    static_assert(std::is_same<typename Sink::category, awaitable_sink>::value,
+                  "async_outstream requires awaitable_sink");
+public:
+    typedef typename Sink::char_type     char_type;
+    typedef std::char_traits<char_type> traits_type;
+
+    /**
+     * Main constructor.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template<class... Args>
+    explicit async_outstream(Args&&... args) : _sink{std::forward<Args>(args)...} { allocate(); }
+    /**
+     * Constructor with buffering policy.
+     *
+     * @param buffering buffering policy object
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template<class... Args>
+    explicit async_outstream(Buffering buffering, Args&&... args) :
+            _sink{std::forward<Args>(args)...}, _buffering{buffering} { allocate(); }
+
+    async_outstream(async_outstream&& ) = default;
+    async_outstream(const async_outstream& ) = delete;
+    async_outstream& operator=(const async_outstream& ) = delete;
+
+    Sink& operator*() { return _sink; }
+    Sink* operator->() { return &_sink; }
+    const Sink& operator*() const { return _sink; }
+    const Sink* operator->() const { return &_sink; }
+
+    /**
+     * Writes the characters, suspending only if they do not fit into the
+     * buffer.
+     *
+     * @param s characters to write
+     * @param n number of characters
+     * @return awaitable of <code>true</code> if the characters are written
+     *         (or buffered), <code>false</code> if the sink failed.
+     */
+    auto write(const char_type* s, std::size_t n) { return write_awaiter{*this, s, n}; }
+    /**
+     * @param s characters to write
+     * @return awaitable of <code>false</code> if the sink failed.
+     */
+    template<typename T, std::size_t Extent>
+        requires std::is_same_v<std::remove_const_t<T>, char_type>
+    auto write(std::span<T, Extent> s) { return write(s.data(), s.size()); }
+    /**
+     * @param s string to write
+     * @return awaitable of <code>false</code> if the sink failed.
+     */
+    auto write(std::basic_string_view<char_type> s) { return write(s.data(), s.size()); }
+
+    /**
+     * Writes the buffer and flushes the sink.
+     *
+     * @return <code>false</code> if the sink failed.
+     */
+    task<bool> flush()
+    {
+        bool written = co_await write_buffer();
+        if (!written) co_return false;
+        co_await _sink.flush();
+        co_return !_fail;
+    }
+
+    /**
+     * @return <code>true</code> if the sink failed.
+     */
+    bool fail() const { return _fail; }
+    explicit operator bool() const { return !_fail; }
+    bool operator!() const { return _fail; }
+
+private:
+    class write_awaiter
+    {
+    public:
+        write_awaiter(async_outstream& out, const char_type* s, std::size_t n) : _out{out}, _s{s}, _n{n} {}
+
+        bool await_ready()
+        {
+            if (_out._fail) return true;
+            if (_out._size + _n > _out._capacity) return false;
+            traits_type::copy(_out._buffer.get() + _out._size, _s, _n);
+            _out._size += _n;
+            return true;
+        }
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+        {
+            _slow.emplace(_out.write_sink(_s, _n));
+            return _slow->await_suspend(h);
+        }
+        bool await_resume() { return _slow ? _slow->await_resume() : !_out._fail; }
+
+    private:
+        async_outstream& _out;
+        const char_type* _s;
+        std::size_t _n;
+        std::optional<task<bool>> _slow;
+    };
+
+    void allocate()
+    {
+        _capacity = _buffering.size();
+        if (_capacity > 0) _buffer.reset(new char_type[_capacity]);
+    }
+
+    task<bool> write_all(const char_type* s, std::size_t n)
+    {
+        while (n > 0)
+        {
+            std::size_t done = co_await _sink.write_some(s, n);
+            if (done == 0)
+            {
+                _fail = true;
+                co_return false;
+            }
+            s += done;
+            n -= done;
+        }
+        co_return true;
+    }
+
+    task<bool> write_buffer()
+    {
+        std::size_t size = std::exchange(_size, 0);
+        return write_all(_buffer.get(), size);
+    }
+
+    task<bool> write_sink(const char_type* s, std::size_t n)
+    {
+        bool written = co_await write_buffer();
+        if (!written) co_return false;
+        if (n >= _capacity) co_return co_await write_all(s, n);
+        traits_type::copy(_buffer.get(), s, n);
+        _size = n;
+        co_return true;
+    }
+
+    Sink _sink;
+    Buffering _buffering;
+    std::unique_ptr<char_type[]> _buffer;
+    std::size_t _capacity = 0;
+    std::size_t _size = 0;
+    bool _fail = false;
+};
+
+/**
+ * Adapter making the input side of an asynchronous device usable as the
+ * source of nova::async_instream, see nova::async_device_instream.
+ *
+ * @tparam Device device with <code>in_category</code> nova::awaitable_source
+ */
+template<typename Device>
+class async_device_source
+{
+public:
+    typedef typename Device::char_type   char_type;
+    typedef typename Device::in_category category;
+
+    explicit async_device_source(Device& device) : _device{device} {}
+
+    auto read_some(char_type* s, std::size_t n) { return _device.read_some(s, n); }
+
+private:
+    Device& _device;
+};
+
+/**
+ * Adapter making the output side of an asynchronous device usable as the
+ * sink of nova::async_outstream, see nova::async_device_outstream.
+ *
+ * @tparam Device device with <code>out_category</code> nova::awaitable_sink
+ */
+template<typename Device>
+class async_device_sink
+{
+public:
+    typedef typename Device::char_type    char_type;
+    typedef typename Device::out_category category;
+
+    explicit async_device_sink(Device& device) : _device{device} {}
+
+    auto write_some(const char_type* s, std::size_t n) { return _device.write_some(s, n); }
+    auto flush() { return _device.flush(); }
+
+private:
+    Device& _device;
+};
+
+/**
+ * Type definition for asynchronous input stream sharing <code>Device</code>
+ * with nova::async_device_outstream.
+ */
+template<typename Device, typename Buffering = non_buffered>
+using async_device_instream = async_instream<async_device_source<Device>, Buffering>;
+
+/**
+ * Type definition for asynchronous output stream sharing <code>Device</code>
+ * with nova::async_device_instream.
+ */
+template<typename Device, typename Buffering = non_buffered>
+using async_device_outstream = async_outstream<async_device_sink<Device>, Buffering>;
+
+} // end of nova namespace
+
+#endif // NOVA_ASYNC_STREAM_H
@@ -0,0 +1,225 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_BUFFER_POOL_H
+#define NOVA_BUFFER_POOL_H
+
+#include <cstddef>
+#include <new>
+
+/**
+ * @file buffer_pool.h
+ * @brief Thread local pool of memory blocks for stream buffers.
+ *
+ * Streams which are created and destroyed at a high rate (e.g. a stream per
+ * request) spend a noticeable time allocating their stream buffer objects
+ * and buffers. With nova::pool_allocator as the <code>Allocator</code>
+ * parameter of nova::outstream or nova::instream those blocks are recycled
+ * through a per-thread free list and at steady state no heap allocation
+ * takes place:
+ *
+ * ~~~~~{.cpp}
+ * typedef nova::outstream<my_sink, nova::buffer_4k, std::char_traits<char>,
+ *                         nova::pool_allocator<char>> pooled_outstream;
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Thread local pool of memory blocks.
+ *
+ * Requests are rounded up to a power of two between
+ * <code>min_block</code> and <code>max_block</code> bytes; each size class
+ * keeps up to <code>max_cached</code> free blocks. Larger requests go
+ * directly to <code>operator new</code>. Blocks may be freed by a thread
+ * other than the one which allocated them, they just end up in the pool
+ * of the freeing thread.
+ */
+class buffer_pool
+{
+public:
+    /**
+     * Smallest block size.
+     */
+    static constexpr std::size_t min_block = 64;
+    /**
+     * Largest pooled block size.
+     */
+    static constexpr std::size_t max_block = std::size_t{1} << 22;
+    /**
+     * Maximum number of free blocks kept per size class.
+     */
+    static constexpr std::size_t max_cached = 16;
+
+    /**
+     * Per-thread pool counters.
+     */
+    struct statistics
+    {
+        /**
+         * Allocations served from the pool.
+         */
+        std::size_t hits = 0;
+        /**
+         * Allocations which had to go to <code>operator new</code>.
+         */
+        std::size_t misses = 0;
+    };
+
+    /**
+     * Allocates block of at least <code>size</code> bytes.
+     *
+     * @param size requested size
+     * @return pointer to the block
+     */
+    static void* allocate(std::size_t size)
+    {
+        pool* local = instance();
+        if (size > max_block || !local)
+        {
+            if (local) ++local->stats.misses;
+            return ::operator new(size);
+        }
+        std::size_t cls = size_class(size);
+        if (node* block = local->free[cls])
+        {
+            local->free[cls] = block->next;
+            --local->count[cls];
+            ++local->stats.hits;
+            return block;
+        }
+        ++local->stats.misses;
+        return ::operator new(min_block << cls);
+    }
+
+    /**
+     * Returns block to the pool.
+     *
+     * @param block pointer returned by <code>allocate</code>
+     * @param size the size it was allocated with
+     */
+    static void deallocate(void* block, std::size_t size) noexcept
+    {
+        pool* local = instance();
+        if (size > max_block || !local)
+        {
+            ::operator delete(block);
+            return;
+        }
+        std::size_t cls = size_class(size);
+        if (local->count[cls] >= max_cached)
+        {
+            ::operator delete(block);
+            return;
+        }
+        local->free[cls] = new (block) node{local->free[cls]};
+        ++local->count[cls];
+    }
+
+    /**
+     * @return counters of the calling thread's pool.
+     */
+    static statistics stats()
+    {
+        pool* local = instance();
+        return local ? local->stats : statistics{};
+    }
+
+    /**
+     * Resets counters of the calling thread's pool.
+     */
+    static void reset_stats()
+    {
+        if (pool* local = instance()) local->stats = statistics{};
+    }
+
+    /**
+     * Frees all cached blocks of the calling thread's pool.
+     */
+    static void release() noexcept
+    {
+        if (pool* local = instance()) local->clear();
+    }
+
+private:
+    static constexpr std::size_t classes = 17; /* 64 bytes .. 4Mb */
+
+    struct node { node* next; };
+
+    struct pool
+    {
+        node* free[classes] = {};
+        std::size_t count[classes] = {};
+        statistics stats;
+
+        ~pool() { clear(); destroyed() = true; }
+
+        void clear() noexcept
+        {
+            for (std::size_t cls = 0; cls < classes; ++cls)
+            {
+                while (node* block = free[cls])
+                {
+                    free[cls] = block->next;
+                    ::operator delete(block);
+                }
+                count[cls] = 0;
+            }
+        }
+    };
+
+    /* Returns nullptr once the thread's pool has been destroyed, so that
+     * streams outliving it (e.g. static ones) fall back to the heap. */
+    static pool* instance() noexcept
+    {
+        if (destroyed()) return nullptr;
+        static thread_local pool local;
+        return &local;
+    }
+
+    static bool& destroyed() noexcept
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    static std::size_t size_class(std::size_t size) noexcept
+    {
+        std::size_t cls = 0;
+        for (std::size_t block = min_block; block < size; block <<= 1) ++cls;
+        return cls;
+    }
+};
+
+/**
+ * Standard allocator which takes its memory from nova::buffer_pool.
+ *
+ * @tparam T value type
+ */
+template<typename T>
+class pool_allocator
+{
+public:
+    typedef T value_type;
+
+    pool_allocator() noexcept = default;
+    template<typename U>
+    pool_allocator(const pool_allocator<U>& ) noexcept {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(buffer_pool::allocate(n * sizeof(T))); }
+    void deallocate(T* p, std::size_t n) noexcept { buffer_pool::deallocate(p, n * sizeof(T)); }
+
+    template<typename U>
+    bool operator==(const pool_allocator<U>& ) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const pool_allocator<U>& ) const noexcept { return false; }
+};
+
+} // end of nova namespace
+
+#endif // NOVA_BUFFER_POOL_H
@@ -0,0 +1,394 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_DEFLATE_FILTER_H
+#define NOVA_DEFLATE_FILTER_H
+
+#include <nova/filter.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+/**
+ * @file deflate_filter.h
+ * @brief gzip compression and decompression filters.
+ *
+ * Requires zlib: link with the <code>nstream_deflate</code> CMake target.
+ *
+ * ~~~~~{.cpp}
+ * nova::deflate_outstream<nova::file_sink> out{"data.gz"};
+ * out->filter<nova::deflate_compressor>().set_params({6, 8});  // level 6, 8 threads
+ * out << data;
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Parameters of nova::deflate_compressor.
+ */
+struct deflate_params
+{
+    /**
+     * Compression level, 0-9.
+     */
+    int level = Z_DEFAULT_COMPRESSION;
+    /**
+     * Number of worker threads. Zero compresses in the writing thread as one
+     * continuous gzip stream. Otherwise the data is cut into blocks of
+     * <code>block_size</code> bytes which are compressed in parallel into
+     * independent gzip members and written in the original order. A
+     * flush of the stream writes the complete blocks only; the partial
+     * block is kept until it fills up or the stream is closed, so flushing
+     * often (e.g. <code>std::endl</code>) does not cut the data into small
+     * members. Without any data one empty member is written on close, so
+     * the output is a valid gzip file in both modes.
+     */
+    unsigned threads = 0;
+    /**
+     * Size of the independently compressed blocks in the multi-threaded mode.
+     */
+    std::size_t block_size = 1 << 20;
+};
+
+/**
+ * Fixed size pool of worker threads for nova::deflate_compressor.
+ */
+class deflate_workers
+{
+public:
+    explicit deflate_workers(unsigned threads)
+    {
+        for (unsigned i = 0; i < threads; ++i) _threads.emplace_back([this] { run(); });
+    }
+
+    deflate_workers(const deflate_workers& ) = delete;
+    deflate_workers& operator=(const deflate_workers& ) = delete;
+
+    ~deflate_workers()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _stop = true;
+        }
+        _cond.notify_all();
+        for (auto& thread : _threads) thread.join();
+    }
+
+    void submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _tasks.push_back(std::move(task));
+        }
+        _cond.notify_one();
+    }
+
+private:
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock{_mutex};
+                _cond.wait(lock, [this] { return _stop || !_tasks.empty(); });
+                if (_tasks.empty()) return;
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> _threads;
+    std::deque<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _stop = false;
+};
+
+/**
+ * Output filter compressing data into gzip format.
+ *
+ * @see deflate_params
+ * @see deflate_outstream
+ */
+class deflate_compressor
+{
+public:
+    typedef char   char_type;
+    typedef filter category;
+
+    deflate_compressor() = default;
+    deflate_compressor(const deflate_compressor& ) = delete;
+    deflate_compressor& operator=(const deflate_compressor& ) = delete;
+
+    ~deflate_compressor()
+    {
+        _workers.reset();
+        if (_initialized) deflateEnd(&_stream);
+    }
+
+    /**
+     * Sets compression parameters. Must be called before anything is
+     * written to the stream.
+     *
+     * @param params compression parameters
+     */
+    void set_params(const deflate_params& params) { _params = params; }
+
+    template<typename Next>
+    std::streamsize write(Next& next, const char_type* s, std::streamsize n)
+    {
+        if (_params.threads > 0) return write_block(next, s, n);
+        if (!init()) return 0;
+        _stream.next_in = reinterpret_cast<Bytef*>(const_cast<char_type*>(s));
+        _stream.avail_in = static_cast<uInt>(n);
+        return deflate_all(next, Z_NO_FLUSH) ? n : 0;
+    }
+
+    template<typename Next>
+    void flush(Next& next)
+    {
+        /* Multi-threaded: the partial block stays open, see deflate_params::threads. */
+        if (_params.threads > 0) drain(next, 0);
+        else if (_initialized) deflate_all(next, Z_SYNC_FLUSH);
+    }
+
+    template<typename Next>
+    void close(Next& next)
+    {
+        if (_params.threads > 0)
+        {
+            submit_block();
+            drain(next, 0);
+            /* Empty data still makes one (empty) member, as in the single-threaded mode. */
+            if (!_submitted)
+            {
+                _submitted = true;
+                std::vector<char> out = compress({}, _params.level);
+                next.write(out.data(), static_cast<std::streamsize>(out.size()));
+            }
+        }
+        else if (init()) deflate_all(next, Z_FINISH);
+    }
+
+private:
+    bool init()
+    {
+        if (_initialized) return true;
+        _stream = z_stream{};
+        _initialized = deflateInit2(&_stream, _params.level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+        return _initialized;
+    }
+
+    template<typename Next>
+    bool deflate_all(Next& next, int mode)
+    {
+        char out[16384];
+        int res;
+        do
+        {
+            _stream.next_out = reinterpret_cast<Bytef*>(out);
+            _stream.avail_out = sizeof(out);
+            res = deflate(&_stream, mode);
+            if (res == Z_STREAM_ERROR) return false;
+            auto size = static_cast<std::streamsize>(sizeof(out) - _stream.avail_out);
+            if (size > 0 && next.write(out, size) < size) return false;
+        }
+        while (_stream.avail_out == 0 || (mode == Z_FINISH && res != Z_STREAM_END));
+        return true;
+    }
+
+    /* Multi-threaded mode: every block becomes a complete gzip member;
+     * concatenated members form a valid gzip stream. */
+    template<typename Next>
+    std::streamsize write_block(Next& next, const char_type* s, std::streamsize n)
+    {
+        if (!_workers) _workers = std::make_unique<deflate_workers>(_params.threads);
+        std::streamsize done = 0;
+        while (done < n)
+        {
+            std::size_t chunk = _params.block_size - _block.size();
+            if (static_cast<std::streamsize>(chunk) > n - done) chunk = static_cast<std::size_t>(n - done);
+            _block.insert(_block.end(), s + done, s + done + chunk);
+            done += static_cast<std::streamsize>(chunk);
+            if (_block.size() >= _params.block_size)
+            {
+                submit_block();
+                if (!drain(next, 2 * _params.threads)) return 0;
+            }
+        }
+        return n;
+    }
+
+    void submit_block()
+    {
+        if (_block.empty()) return;
+        auto task = std::make_shared<std::packaged_task<std::vector<char>()>>(
+                [input = std::move(_block), level = _params.level] { return compress(input, level); });
+        _block = std::vector<char>{};
+        _block.reserve(_params.block_size);
+        _pending.push_back(task->get_future());
+        _workers->submit([task] { (*task)(); });
+        _submitted = true;
+    }
+
+    /* Writes completed blocks in order until no more than max_pending remain in flight. */
+    template<typename Next>
+    bool drain(Next& next, std::size_t max_pending)
+    {
+        while (_pending.size() > max_pending)
+        {
+            std::vector<char> out = _pending.front().get();
+            _pending.pop_front();
+            auto size = static_cast<std::streamsize>(out.size());
+            if (size == 0 || next.write(out.data(), size) < size) return false;
+        }
+        return true;
+    }
+
+    static std::vector<char> compress(const std::vector<char>& input, int level)
+    {
+        z_stream stream{};
+        if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return {};
+        std::vector<char> out(deflateBound(&stream, static_cast<uLong>(input.size())));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+        stream.avail_in = static_cast<uInt>(input.size());
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = static_cast<uInt>(out.size());
+        int res = deflate(&stream, Z_FINISH);
+        out.resize(res == Z_STREAM_END ? stream.total_out : 0);
+        deflateEnd(&stream);
+        return out;
+    }
+
+    deflate_params _params;
+    z_stream _stream{};
+    bool _initialized = false;
+    std::vector<char> _block;
+    /* A member has been written or is being compressed. */
+    bool _submitted = false;
+    std::deque<std::future<std::vector<char>>> _pending;
+    std::unique_ptr<deflate_workers> _workers;
+};
+
+/**
+ * Input filter decompressing gzip (including concatenated gzip members)
+ * and zlib formats.
+ *
+ * Data ending in the middle of a member, corrupt data and errors of the
+ * source are not taken for the end of the stream: the read fails with
+ * <code>std::ios_base::failure</code>, which sets <code>badbit</code> on
+ * the stream (and is rethrown if the stream has exceptions enabled for
+ * it). The cause is available from <code>error()</code>.
+ *
+ * @see deflate_instream
+ */
+class deflate_decompressor
+{
+public:
+    typedef char   char_type;
+    typedef filter category;
+
+    deflate_decompressor() = default;
+    deflate_decompressor(const deflate_decompressor& ) = delete;
+    deflate_decompressor& operator=(const deflate_decompressor& ) = delete;
+
+    ~deflate_decompressor() { if (_initialized) inflateEnd(&_stream); }
+
+    template<typename Prev>
+    std::streamsize read(Prev& prev, char_type* s, std::streamsize n)
+    {
+        if (!_initialized)
+        {
+            _stream = z_stream{};
+            if (inflateInit2(&_stream, 15 + 32) != Z_OK) return 0;
+            _initialized = true;
+        }
+        _stream.next_out = reinterpret_cast<Bytef*>(s);
+        _stream.avail_out = static_cast<uInt>(n);
+        while (_error == Z_OK && _stream.avail_out == static_cast<uInt>(n))
+        {
+            if (_stream.avail_in == 0)
+            {
+                if (_eof) break;
+                std::streamsize read = prev.read(_in, static_cast<std::streamsize>(sizeof(_in)));
+                if (read <= 0)
+                {
+                    _eof = true;
+                    if (read < 0) _error = Z_ERRNO;
+                    else if (!_ended) _error = Z_BUF_ERROR;
+                    break;
+                }
+                _stream.next_in = reinterpret_cast<Bytef*>(_in);
+                _stream.avail_in = static_cast<uInt>(read);
+            }
+            /* Input after the end of a member starts the next one. */
+            _ended = false;
+            int res = inflate(&_stream, Z_NO_FLUSH);
+            if (res == Z_STREAM_END)
+            {
+                inflateReset(&_stream);
+                _ended = true;
+            }
+            else if (res != Z_OK && res != Z_BUF_ERROR) _error = res;
+        }
+        std::streamsize done = n - static_cast<std::streamsize>(_stream.avail_out);
+        /* What was decompressed before the error is returned first. */
+        if (done == 0 && _error != Z_OK) throw std::ios_base::failure{"nova::deflate_decompressor: truncated or corrupt data"};
+        return done;
+    }
+
+    /**
+     * @return <code>Z_OK</code> or the cause of the failure:
+     *         <code>Z_BUF_ERROR</code> if the data ends in the middle of a
+     *         gzip member, <code>Z_ERRNO</code> if the source failed,
+     *         otherwise the error returned by <code>inflate</code> (e.g.
+     *         <code>Z_DATA_ERROR</code> for corrupt data).
+     */
+    int error() const { return _error; }
+
+private:
+    z_stream _stream{};
+    bool _initialized = false;
+    bool _eof = false;
+    /* No member is open: the data may end here. Empty data is an empty stream. */
+    bool _ended = true;
+    int _error = Z_OK;
+    char_type _in[16384];
+};
+
+/**
+ * Type definition for output stream compressing into <code>Sink</code>.
+ *
+ * @tparam Sink final sink, nova::sink or nova::out_buffer_provider
+ */
+template<typename Sink>
+using deflate_outstream = filtered_outstream<Sink, deflate_compressor>;
+
+/**
+ * Type definition for input stream decompressing from <code>Source</code>.
+ *
+ * @tparam Source original source, nova::source or nova::in_buffer_provider
+ */
+template<typename Source>
+using deflate_instream = filtered_instream<Source, deflate_decompressor>;
+
+} // end of nova namespace
+
+#endif // NOVA_DEFLATE_FILTER_H
@@ -0,0 +1,311 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_EPOLL_REACTOR_H
+#define NOVA_EPOLL_REACTOR_H
+
+#include <nova/async_stream.h>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/**
+ * @file epoll_reactor.h
+ * @brief <code>epoll</code> based reactor and asynchronous file descriptor device.
+ *
+ * ~~~~~{.cpp}
+ * nova::epoll_reactor reactor;
+ * nova::async_fd fd{reactor, socket};
+ * reactor.spawn(echo(nova::async_device_instream<nova::async_fd, nova::buffer_4k>{fd},
+ *                    nova::async_device_outstream<nova::async_fd, nova::buffer_4k>{fd}));
+ * reactor.run();
+ * ~~~~~
+ *
+ * This header is Linux only and requires C++20.
+ */
+
+namespace nova {
+
+/**
+ * Single-threaded event loop: nova::executor plus <code>epoll</code>
+ * readiness notification for file descriptors.
+ *
+ * Descriptors are registered edge-triggered once for both directions, so a
+ * wait for readiness costs no system call besides the shared
+ * <code>epoll_wait</code>.
+ */
+class epoll_reactor
+{
+public:
+    /**
+     * Registration of a file descriptor, see <code>add</code>.
+     */
+    struct io_state
+    {
+        int fd = -1;
+        std::coroutine_handle<> reader;
+        std::coroutine_handle<> writer;
+        /* Readiness reported while nobody was waiting. */
+        bool readable = false;
+        bool writable = false;
+    };
+
+    epoll_reactor() : _epoll{::epoll_create1(EPOLL_CLOEXEC)} { if (_epoll < 0) _error = errno; }
+    epoll_reactor(const epoll_reactor& ) = delete;
+    epoll_reactor& operator=(const epoll_reactor& ) = delete;
+
+    ~epoll_reactor() noexcept { if (_epoll >= 0) ::close(_epoll); }
+
+    /**
+     * @return <code>true</code> if the <code>epoll</code> instance was created.
+     */
+    bool is_open() const { return _epoll >= 0; }
+    /**
+     * @return <code>errno</code> of the last failed operation or 0.
+     */
+    int error() const { return _error; }
+
+    /**
+     * @return the executor running the coroutines.
+     */
+    nova::executor& executor() { return _executor; }
+
+    /**
+     * Starts the task on the reactor's executor.
+     */
+    void spawn(task<> t) { _executor.spawn(std::move(t)); }
+
+    /**
+     * Runs the coroutines and waits for descriptor events until all spawned
+     * tasks finish or none of them can make progress.
+     */
+    void run()
+    {
+        for (;;)
+        {
+            _executor.run();
+            if (_executor.alive() == 0 || _waiting == 0) return;
+            if (!poll(-1)) return;
+        }
+    }
+
+    /**
+     * Waits for descriptor events and queues the coroutines waiting for them.
+     *
+     * @param timeout timeout in milliseconds, -1 waits indefinitely
+     * @return <code>false</code> if <code>epoll_wait</code> failed.
+     */
+    bool poll(int timeout)
+    {
+        epoll_event events[64];
+        int count = ::epoll_wait(_epoll, events, 64, timeout);
+        if (count < 0)
+        {
+            if (errno == EINTR) return true;
+            _error = errno;
+            return false;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            auto& state = *static_cast<io_state*>(events[i].data.ptr);
+            /* Errors and hangups wake both sides: the next call reports them. */
+            bool failed = events[i].events & (EPOLLERR | EPOLLHUP);
+            if (failed || (events[i].events & (EPOLLIN | EPOLLRDHUP))) notify(state.reader, state.readable);
+            if (failed || (events[i].events & EPOLLOUT)) notify(state.writer, state.writable);
+        }
+        return true;
+    }
+
+    /**
+     * Registers the descriptor. It must be in non-blocking mode.
+     *
+     * @return <code>false</code> if the descriptor cannot be polled (e.g.
+     *         a regular file).
+     */
+    bool add(io_state& state)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = &state;
+        if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, state.fd, &event) == 0) return true;
+        _error = errno;
+        return false;
+    }
+
+    /**
+     * Unregisters the descriptor. Nobody may be waiting for it.
+     */
+    void remove(io_state& state) { ::epoll_ctl(_epoll, EPOLL_CTL_DEL, state.fd, nullptr); }
+
+    /**
+     * @return awaitable completing when the descriptor may be readable.
+     */
+    auto readable(io_state& state) { return ready_awaiter{*this, state.reader, state.readable}; }
+    /**
+     * @return awaitable completing when the descriptor may be writable.
+     */
+    auto writable(io_state& state) { return ready_awaiter{*this, state.writer, state.writable}; }
+
+private:
+    struct ready_awaiter
+    {
+        epoll_reactor& reactor;
+        std::coroutine_handle<>& waiter;
+        bool& ready;
+
+        bool await_ready() const noexcept { return std::exchange(ready, false); }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            waiter = h;
+            ++reactor._waiting;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    void notify(std::coroutine_handle<>& waiter, bool& ready)
+    {
+        if (!waiter)
+        {
+            ready = true;
+            return;
+        }
+        _executor.post(std::exchange(waiter, nullptr));
+        --_waiting;
+    }
+
+    nova::executor _executor;
+    int _epoll;
+    int _error = 0;
+    /* Coroutines waiting for descriptor events. */
+    std::size_t _waiting = 0;
+};
+
+/**
+ * Asynchronous file descriptor device for pipes, sockets and terminals.
+ *
+ * The device is nova::awaitable_source and nova::awaitable_sink at the same
+ * time, so it can be shared between nova::async_device_instream and
+ * nova::async_device_outstream. The descriptor is switched to non-blocking
+ * mode and registered with nova::epoll_reactor; reads and writes are tried
+ * first and await readiness only when the descriptor would block.
+ *
+ * Failed reads and writes complete with 0; the <code>errno</code> value is
+ * available from <code>error()</code>. Regular files cannot be polled:
+ * <code>is_open</code> is <code>false</code> for them.
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_async_fd
+{
+public:
+    typedef CharT            char_type;
+    typedef awaitable_source in_category;
+    typedef awaitable_sink   out_category;
+
+    /**
+     * @param reactor reactor to register the descriptor with
+     * @param fd file descriptor
+     * @param owns_fd whether the descriptor is closed together with the device
+     */
+    basic_async_fd(epoll_reactor& reactor, int fd, bool owns_fd = true) : _reactor{reactor}, _owns_fd{owns_fd}
+    {
+        _state.fd = fd;
+        int flags = ::fcntl(fd, F_GETFL);
+        if (flags < 0 || (!(flags & O_NONBLOCK) && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) ||
+            !_reactor.add(_state))
+        {
+            _error = flags < 0 ? errno : _reactor.error();
+            if (_owns_fd) ::close(fd);
+            _state.fd = -1;
+        }
+    }
+
+    basic_async_fd(const basic_async_fd& ) = delete;
+    basic_async_fd& operator=(const basic_async_fd& ) = delete;
+
+    ~basic_async_fd() noexcept { close(); }
+
+    /**
+     * @return <code>true</code> if the descriptor is open and registered.
+     */
+    bool is_open() const { return _state.fd >= 0; }
+    /**
+     * @return <code>errno</code> of the last failed operation or 0.
+     */
+    int error() const { return _error; }
+    /**
+     * @return the underlying file descriptor.
+     */
+    int fd() const { return _state.fd; }
+
+    /**
+     * Unregisters and, if owned, closes the descriptor. Nobody may be
+     * waiting for it.
+     */
+    void close() noexcept
+    {
+        if (_state.fd < 0) return;
+        _reactor.remove(_state);
+        if (_owns_fd) ::close(_state.fd);
+        _state.fd = -1;
+    }
+
+    /* awaitable_source function */
+    task<std::size_t> read_some(char_type* s, std::size_t n)
+    {
+        for (;;)
+        {
+            if (_state.fd < 0) co_return 0;
+            ssize_t res = ::read(_state.fd, s, n * sizeof(char_type));
+            if (res >= 0) co_return static_cast<std::size_t>(res) / sizeof(char_type);
+            if (errno == EAGAIN || errno == EWOULDBLOCK) co_await _reactor.readable(_state);
+            else if (errno != EINTR)
+            {
+                _error = errno;
+                co_return 0;
+            }
+        }
+    }
+
+    /* awaitable_sink functions */
+    task<std::size_t> write_some(const char_type* s, std::size_t n)
+    {
+        for (;;)
+        {
+            if (_state.fd < 0) co_return 0;
+            ssize_t res = ::write(_state.fd, s, n * sizeof(char_type));
+            if (res > 0) co_return static_cast<std::size_t>(res) / sizeof(char_type);
+            if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) co_await _reactor.writable(_state);
+            else if (res == 0 || errno != EINTR)
+            {
+                _error = res == 0 ? EIO : errno;
+                co_return 0;
+            }
+        }
+    }
+
+    std::suspend_never flush() { return {}; }
+
+private:
+    epoll_reactor& _reactor;
+    epoll_reactor::io_state _state;
+    bool _owns_fd;
+    int _error = 0;
+};
+
+/**
+ * Type definition for asynchronous file descriptor device of <code>char</code>.
+ */
+typedef basic_async_fd<char> async_fd;
+
+} // end of nova namespace
+
+#endif // NOVA_EPOLL_REACTOR_H
@@ -0,0 +1,253 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_FAST_FORMAT_H
+#define NOVA_FAST_FORMAT_H
+
+#include <nova/io.h>
+
+#include <charconv>
+#include <locale>
+#include <string>
+#include <string_view>
+
+/**
+ * @file fast_format.h
+ * @brief Locale free formatted output based on <code>std::to_chars</code>.
+ *
+ * Inserting nova::fast_format into a stream switches the rest of the
+ * expression to the fast mode:
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<my_sink, nova::buffer_8k> out;
+ * out << nova::fast_format << id << ',' << price << ',' << name << '\n';
+ * ~~~~~
+ *
+ * In this mode numbers are written with <code>std::to_chars</code> straight
+ * into the stream buffer (or the nova::out_buffer_provider span) and
+ * strings are copied there directly, bypassing the sentry and
+ * <code>num_put</code>. The output is identical to the standard one.
+ * Whenever the stream is set up for formatting <code>std::to_chars</code>
+ * cannot reproduce (non classic locale, field width, <code>showpos</code>,
+ * <code>showbase</code>, <code>showpoint</code>, <code>uppercase</code>,
+ * <code>boolalpha</code>, <code>hexfloat</code>, <code>unitbuf</code>,
+ * tied stream) the insertion falls back to the standard path.
+ *
+ * The mode lasts until the end of the expression. For loops the
+ * nova::fast_ostream object can be created once:
+ *
+ * ~~~~~{.cpp}
+ * nova::fast_ostream<decltype(out)> fast{out};
+ * for (auto v : values) fast << v << ' ';
+ * ~~~~~
+ *
+ * Requires C++17.
+ */
+
+namespace nova {
+
+/**
+ * Type of nova::fast_format manipulator.
+ */
+struct fast_format_t {};
+
+/**
+ * Manipulator switching the rest of the insertion expression to the
+ * <code>std::to_chars</code> based formatting.
+ */
+constexpr fast_format_t fast_format{};
+
+/**
+ * Insertion proxy for the <code>std::to_chars</code> based formatting.
+ *
+ * The locale of the stream is checked when the proxy is created, the rest
+ * of the format flags at every insertion.
+ *
+ * @tparam Stream <code>std::basic_ostream</code> or derived type. If it
+ *                has <code>out_span</code> and <code>commit</code> methods
+ *                (nova::outstream) the values are formatted directly in
+ *                the stream buffer.
+ */
+template<typename Stream>
+class fast_ostream
+{
+public:
+    typedef typename Stream::char_type   char_type;
+    typedef typename Stream::traits_type traits_type;
+    typedef std::basic_ostream<char_type, traits_type> ostream_type;
+
+    explicit fast_ostream(Stream& stream) :
+            _stream{stream}, _classic{stream.getloc() == std::locale::classic()} {}
+
+    /**
+     * @return the underlying stream.
+     */
+    Stream& stream() { return _stream; }
+
+    template<typename T>
+    fast_ostream& operator<<(const T& value)
+    {
+        if constexpr (!std::is_same<char_type, char>::value) _stream << value;
+        else if constexpr (std::is_same<T, bool>::value) insert_bool(value);
+        else if constexpr (std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+                           std::is_same<T, unsigned char>::value)
+        {
+            char ch = static_cast<char>(value);
+            insert_string(&ch, 1, value);
+        }
+        else if constexpr (std::is_integral<T>::value) insert_integer(value);
+        else if constexpr (std::is_floating_point<T>::value) insert_float(value);
+        else if constexpr (std::is_convertible<const T&, std::string_view>::value)
+        {
+            std::string_view str{value};
+            insert_string(str.data(), str.size(), value);
+        }
+        else _stream << value;
+        return *this;
+    }
+
+    fast_ostream& operator<<(std::ios_base& (*manip)(std::ios_base&))
+    {
+        manip(_stream);
+        return *this;
+    }
+    fast_ostream& operator<<(ostream_type& (*manip)(ostream_type&))
+    {
+        manip(_stream);
+        return *this;
+    }
+
+private:
+    bool fast(std::ios_base::fmtflags unsupported) const
+    {
+        return _classic && _stream.width() == 0 && !(_stream.flags() & unsupported) &&
+               _stream.good() && !_stream.tie();
+    }
+
+    static constexpr std::ios_base::fmtflags _common = std::ios_base::unitbuf | std::ios_base::showpos |
+                                                       std::ios_base::uppercase;
+
+    template<typename T>
+    void insert_string(const char* s, std::size_t n, const T& value)
+    {
+        if (!fast(std::ios_base::unitbuf))
+        {
+            _stream << value;
+            return;
+        }
+        write(s, n);
+    }
+
+    void insert_bool(bool value)
+    {
+        if (!fast(_common | std::ios_base::boolalpha | std::ios_base::showbase))
+        {
+            _stream << value;
+            return;
+        }
+        char ch = value ? '1' : '0';
+        write(&ch, 1);
+    }
+
+    template<typename T>
+    void insert_integer(T value)
+    {
+        if (!fast(_common | std::ios_base::showbase))
+        {
+            _stream << value;
+            return;
+        }
+        /* Like num_put, hex and oct print the bit pattern of negative numbers. */
+        auto base = _stream.flags() & std::ios_base::basefield;
+        if (base == std::ios_base::hex) put(value, [v = std::make_unsigned_t<T>(value)](char* f, char* l)
+                                            { return std::to_chars(f, l, v, 16); });
+        else if (base == std::ios_base::oct) put(value, [v = std::make_unsigned_t<T>(value)](char* f, char* l)
+                                                 { return std::to_chars(f, l, v, 8); });
+        else put(value, [value](char* f, char* l) { return std::to_chars(f, l, value); });
+    }
+
+    template<typename T>
+    void insert_float(T value)
+    {
+        auto field = _stream.flags() & std::ios_base::floatfield;
+        if (field == std::ios_base::floatfield || !fast(_common | std::ios_base::showpoint))
+        {
+            _stream << value;
+            return;
+        }
+        std::chars_format format = field == std::ios_base::fixed ? std::chars_format::fixed :
+                                   field == std::ios_base::scientific ? std::chars_format::scientific :
+                                   std::chars_format::general;
+        auto precision = static_cast<int>(_stream.precision());
+        put(value, [=](char* f, char* l) { return std::to_chars(f, l, value, format, precision); });
+    }
+
+    /* Formats into the stream's own buffer when it has room, otherwise into
+     * a local one; values which do not fit even there take the standard path. */
+    template<typename T, typename Format>
+    void put(T value, Format format)
+    {
+        if constexpr (_has_span<Stream>(0))
+        {
+            auto [buf, size] = _stream.out_span();
+            if (buf)
+            {
+                auto res = format(buf, buf + size);
+                if (res.ec == std::errc{})
+                {
+                    _stream.commit(static_cast<std::size_t>(res.ptr - buf));
+                    return;
+                }
+            }
+        }
+        char tmp[128];
+        auto res = format(tmp, tmp + sizeof(tmp));
+        if (res.ec != std::errc{}) _stream << value;
+        else write(tmp, static_cast<std::size_t>(res.ptr - tmp));
+    }
+
+    void write(const char* s, std::size_t n)
+    {
+        if constexpr (_has_span<Stream>(0))
+        {
+            auto [buf, size] = _stream.out_span();
+            if (size >= n)
+            {
+                traits_type::copy(buf, s, n);
+                _stream.commit(n);
+                return;
+            }
+        }
+        auto size = static_cast<std::streamsize>(n);
+        if (_stream.rdbuf()->sputn(s, size) != size) _stream.setstate(std::ios_base::badbit);
+    }
+
+    template<typename S>
+    static constexpr auto _has_span(int) -> decltype(std::declval<S&>().out_span(), bool{}) { return true; }
+    template<typename S>
+    static constexpr bool _has_span(...) { return false; }
+
+    Stream& _stream;
+    bool _classic;
+};
+
+/**
+ * Switches the rest of the insertion expression to the
+ * <code>std::to_chars</code> based formatting.
+ *
+ * @param stream output stream
+ * @return nova::fast_ostream proxy for <code>stream</code>
+ */
+template<typename Stream, typename = std::enable_if_t<std::is_base_of<std::ios_base, Stream>::value>>
+fast_ostream<Stream> operator<<(Stream& stream, fast_format_t)
+{
+    return fast_ostream<Stream>{stream};
+}
+
+} // end of nova namespace
+
+#endif // NOVA_FAST_FORMAT_H
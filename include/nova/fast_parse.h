@@ -0,0 +1,372 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_FAST_PARSE_H
+#define NOVA_FAST_PARSE_H
+
+#include <nova/io.h>
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <string>
+#include <tuple>
+
+/**
+ * @file fast_parse.h
+ * @brief Locale free formatted input based on <code>std::from_chars</code>.
+ *
+ * Extracting nova::fast_parse from nova::instream switches the rest of the
+ * expression to the fast mode:
+ *
+ * ~~~~~{.cpp}
+ * nova::instream<my_buffer_provider> in{data};
+ * int id;
+ * double price;
+ * in >> nova::fast_parse >> id >> price;
+ * ~~~~~
+ *
+ * In this mode integers and floating point numbers are parsed with
+ * <code>std::from_chars</code> directly in the stream buffer (or the
+ * nova::in_buffer_provider span), bypassing the sentry and
+ * <code>num_get</code>. Numbers split between two buffers are put together
+ * in a small stitch buffer first. Strings and characters are extracted
+ * directly from the buffer too.
+ *
+ * The values and the stream state are the same as with the standard
+ * extraction for valid input. The standard path is taken when the
+ * stream uses non classic locale, non decimal integer base, field width
+ * or a tied stream, and when the number cannot be parsed in place (e.g.
+ * it is out of range or malformed).
+ *
+ * The mode lasts until the end of the expression. For loops the
+ * nova::fast_istream object can be created once:
+ *
+ * ~~~~~{.cpp}
+ * nova::fast_istream<decltype(in)> fast{in};
+ * while (fast >> value) sum += value;
+ * ~~~~~
+ *
+ * Requires C++17.
+ */
+
+namespace nova {
+
+/**
+ * Type of nova::fast_parse manipulator.
+ */
+struct fast_parse_t {};
+
+/**
+ * Manipulator switching the rest of the extraction expression to the
+ * <code>std::from_chars</code> based parsing.
+ */
+constexpr fast_parse_t fast_parse{};
+
+/**
+ * Extraction proxy for the <code>std::from_chars</code> based parsing.
+ *
+ * The locale of the stream is checked when the proxy is created, the rest
+ * of the format flags at every extraction.
+ *
+ * @tparam Stream nova::instream type of <code>char</code>.
+ */
+template<typename Stream>
+class fast_istream
+{
+public:
+    typedef typename Stream::char_type   char_type;
+    typedef typename Stream::traits_type traits_type;
+    typedef std::basic_istream<char_type, traits_type> istream_type;
+
+    static_assert(std::is_same<char_type, char>::value, "fast_istream supports only char streams");
+
+    explicit fast_istream(Stream& stream) :
+            _stream{stream}, _classic{stream.getloc() == std::locale::classic()} {}
+
+    /**
+     * @return the underlying stream.
+     */
+    Stream& stream() { return _stream; }
+
+    explicit operator bool() const { return !_stream.fail(); }
+    bool operator!() const { return _stream.fail(); }
+
+    template<typename T>
+    fast_istream& operator>>(T& value)
+    {
+        if constexpr (std::is_same<T, bool>::value) _stream >> value;
+        else if constexpr (std::is_same<T, char>::value) extract_char(value);
+        else if constexpr (std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value)
+        {
+            /* Characters as with the standard extraction, not small numbers. */
+            char ch;
+            if (extract_char(ch)) value = static_cast<T>(ch);
+        }
+        else if constexpr (std::is_integral<T>::value) extract_number(value, is_int_char);
+        else if constexpr (std::is_floating_point<T>::value) extract_number(value, is_float_char);
+        else if constexpr (std::is_same<T, std::string>::value) extract_string(value);
+        else _stream >> value;
+        return *this;
+    }
+
+    fast_istream& operator>>(std::ios_base& (*manip)(std::ios_base&))
+    {
+        manip(_stream);
+        return *this;
+    }
+    fast_istream& operator>>(istream_type& (*manip)(istream_type&))
+    {
+        manip(_stream);
+        return *this;
+    }
+
+private:
+    typedef std::pair<const char*, std::size_t> _span_type;
+
+    bool fast() const { return _classic && _stream.width() == 0 && _stream.good() && !_stream.tie(); }
+
+    static bool is_space(char ch) { return ch == ' ' || (ch >= '\t' && ch <= '\r'); }
+    /* Whether ch can continue a number which so far ends with prev. */
+    static bool is_int_char(char , char ch) { return ch >= '0' && ch <= '9'; }
+    static bool is_float_char(char prev, char ch)
+    {
+        if ((ch >= '0' && ch <= '9') || ch == '.' || ch == 'e' || ch == 'E') return true;
+        return (ch == '+' || ch == '-') && (prev == 'e' || prev == 'E');
+    }
+
+    /* Skips whitespace (if skipws is set) and returns the span starting at
+     * the next character or an empty one at the end of the data. */
+    _span_type skip_space()
+    {
+        bool skip = _stream.flags() & std::ios_base::skipws;
+        for (;;)
+        {
+            auto [buf, size] = _stream.in_span();
+            if (!buf) return {nullptr, 0};
+            if (!skip) return {buf, size};
+            std::size_t pos = 0;
+            /* Runs of blanks (e.g. column padding) are skipped a word at a time. */
+            constexpr std::uint64_t blanks = 0x2020202020202020ULL;
+            while (pos + 8 <= size)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, buf + pos, 8);
+                if (word != blanks) break;
+                pos += 8;
+            }
+            while (pos < size && is_space(buf[pos])) ++pos;
+            if (pos < size)
+            {
+                _stream.consume(pos);
+                return {buf + pos, size - pos};
+            }
+            _stream.consume(size);
+        }
+    }
+
+    void end_of_data(std::ios_base::iostate state) { _stream.setstate(state); }
+
+    bool extract_char(char& value)
+    {
+        if (!fast())
+        {
+            _stream >> value;
+            return !_stream.fail();
+        }
+        auto [buf, size] = skip_space();
+        if (!buf)
+        {
+            end_of_data(std::ios_base::eofbit | std::ios_base::failbit);
+            return false;
+        }
+        value = *buf;
+        _stream.consume(1);
+        return true;
+    }
+
+    void extract_string(std::string& value)
+    {
+        if (!fast())
+        {
+            _stream >> value;
+            return;
+        }
+        auto [buf, size] = skip_space();
+        if (!buf) return end_of_data(std::ios_base::eofbit | std::ios_base::failbit);
+        value.clear();
+        for (;;)
+        {
+            std::size_t len = 0;
+            while (len < size && !is_space(buf[len])) ++len;
+            value.append(buf, len);
+            _stream.consume(len);
+            if (len < size) return;
+            std::tie(buf, size) = _stream.in_span();
+            if (!buf) return end_of_data(std::ios_base::eofbit);
+        }
+    }
+
+    template<typename T>
+    static std::from_chars_result parse(const char* first, const char* last, T& value)
+    {
+        /* from_chars does not take '+' which num_get accepts. */
+        if (first != last && *first == '+' && last - first > 1 && first[1] != '-') ++first;
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            /* from_chars takes "inf" and "nan" which num_get rejects. */
+            const char* digits = first != last && *first == '-' ? first + 1 : first;
+            if (digits != last && (*digits == 'i' || *digits == 'I' || *digits == 'n' || *digits == 'N'))
+            {
+                return {first, std::errc::invalid_argument};
+            }
+            return std::from_chars(first, last, value);
+        }
+        else
+        {
+            /* Negative unsigned values are wrapped by num_get: let it do that. */
+            if (std::is_unsigned<T>::value && first != last && *first == '-') return {first, std::errc::invalid_argument};
+            return std::from_chars(first, last, value, 10);
+        }
+    }
+
+    /* Stores what num_get gives for a number out of range of T: the limit
+     * of the sign on overflow, zero on float underflow. Returns true on
+     * overflow, which num_get reports with failbit. */
+    template<typename T>
+    static bool out_of_range(const char* first, const char* last, T& value)
+    {
+        bool negative = *first == '-';
+        if constexpr (std::is_integral<T>::value)
+        {
+            value = negative ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+            return true;
+        }
+        else
+        {
+            if (*first == '-' || *first == '+') ++first;
+            /* Decimal exponent of the first significant digit, plus one. */
+            long magnitude = 0;
+            bool significant = false;
+            bool fraction = false;
+            for (; first != last; ++first)
+            {
+                if (*first == '.') fraction = true;
+                else if (*first < '0' || *first > '9') break;
+                else if (*first != '0') significant = true;
+                if (*first == '.') continue;
+                if (!fraction && significant) ++magnitude;
+                else if (fraction && !significant) --magnitude;
+            }
+            if (first != last && ++first != last)
+            {
+                bool minus = *first == '-';
+                if (*first == '-' || *first == '+') ++first;
+                long exponent = 0;
+                for (; first != last && exponent < 100000; ++first) exponent = exponent * 10 + (*first - '0');
+                magnitude += minus ? -exponent : exponent;
+            }
+            if (magnitude > 0)
+            {
+                value = negative ? -std::numeric_limits<T>::max() : std::numeric_limits<T>::max();
+                return true;
+            }
+            value = negative ? -T{} : T{};
+            return false;
+        }
+    }
+
+    template<typename T, typename IsNumberChar>
+    void extract_number(T& value, IsNumberChar is_number_char)
+    {
+        if (!fast() || (std::is_integral<T>::value &&
+                        (_stream.flags() & std::ios_base::basefield) != std::ios_base::dec))
+        {
+            _stream >> value;
+            return;
+        }
+        auto [buf, size] = skip_space();
+        if (!buf) return end_of_data(std::ios_base::eofbit | std::ios_base::failbit);
+        const char* end = buf + size;
+        T result;
+        auto res = parse(buf, end, result);
+        if (res.ptr != end)
+        {
+            if (res.ec != std::errc{})
+            {
+                /* Nothing is consumed yet: num_get decides what to do with the input. */
+                _stream >> value;
+                return;
+            }
+            /* The parsed number may be the head of a longer one cut by the end
+             * of the buffer (e.g. "1e" of "1e+5"). */
+            const char* stop = res.ptr;
+            for (char prev = stop[-1]; stop != end && is_number_char(prev, *stop); prev = *stop++) {}
+            if (stop != end)
+            {
+                value = result;
+                _stream.consume(static_cast<std::size_t>(res.ptr - buf));
+                return;
+            }
+        }
+        /* The number reaches the end of the buffer and may continue in the next one. */
+        _stitch.assign(buf, size);
+        _stream.consume(size);
+        bool eof = false;
+        for (;;)
+        {
+            std::tie(buf, size) = _stream.in_span();
+            if (!buf)
+            {
+                eof = true;
+                break;
+            }
+            std::size_t len = 0;
+            for (char prev = _stitch.back(); len < size && is_number_char(prev, buf[len]); prev = buf[len++]) {}
+            _stitch.append(buf, len);
+            _stream.consume(len);
+            if (len < size) break;
+        }
+        const char* first = _stitch.data();
+        const char* last = first + _stitch.size();
+        res = parse(first, last, result);
+        if (res.ec == std::errc{} && res.ptr == last) value = result;
+        else if (res.ec == std::errc::result_out_of_range && res.ptr == last)
+        {
+            if (out_of_range(first, last, value)) _stream.setstate(std::ios_base::failbit);
+        }
+        else
+        {
+            value = T{};
+            _stream.setstate(std::ios_base::failbit);
+        }
+        if (eof) _stream.setstate(std::ios_base::eofbit);
+    }
+
+    Stream& _stream;
+    bool _classic;
+    std::string _stitch;
+};
+
+/**
+ * Switches the rest of the extraction expression to the
+ * <code>std::from_chars</code> based parsing.
+ *
+ * @param stream nova::instream
+ * @return nova::fast_istream proxy for <code>stream</code>
+ */
+template<typename Stream, typename = std::enable_if_t<std::is_base_of<std::ios_base, Stream>::value>>
+fast_istream<Stream> operator>>(Stream& stream, fast_parse_t)
+{
+    return fast_istream<Stream>{stream};
+}
+
+} // end of nova namespace
+
+#endif // NOVA_FAST_PARSE_H
@@ -0,0 +1,691 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_FD_DEVICE_H
+#define NOVA_FD_DEVICE_H
+
+#include <nova/io.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+/**
+ * @file fd_device.h
+ * @brief POSIX file descriptor device, sink and source.
+ *
+ * The device handles short reads and writes and <code>EINTR</code>, can
+ * stage output in an internal buffer which is gathered with the caller's
+ * data into one <code>writev</code>, supports <code>O_DIRECT</code> with
+ * aligned block-multiple transfers and passes access pattern hints to the
+ * kernel with <code>posix_fadvise</code>. nova::copy between
+ * nova::file_source and nova::file_sink stays in the kernel on Linux.
+ *
+ * This header is POSIX only.
+ */
+
+namespace nova {
+
+/**
+ * Access pattern hint passed to <code>posix_fadvise</code> when the file
+ * is opened.
+ */
+enum class fd_advice
+{
+    normal,     /**< POSIX_FADV_NORMAL */
+    sequential, /**< POSIX_FADV_SEQUENTIAL */
+    random,     /**< POSIX_FADV_RANDOM */
+    noreuse     /**< POSIX_FADV_NOREUSE */
+};
+
+/**
+ * Tuning parameters of nova::basic_fd_device.
+ */
+struct fd_params
+{
+    /**
+     * Open the file with <code>O_DIRECT</code>. All transfers then go
+     * through aligned internal buffers of <code>buffer_size</code> bytes.
+     * If the file system does not support direct I/O the file is opened
+     * without it, see nova::basic_fd_device::direct().
+     */
+    bool direct = false;
+    /**
+     * Alignment and transfer granularity for <code>O_DIRECT</code>.
+     */
+    std::size_t block_size = 4096;
+    /**
+     * Size in bytes of the internal output buffer (and of the input buffer
+     * in direct mode). Zero disables internal buffering in the regular mode;
+     * in direct mode it defaults to 1Mb. Rounded up to <code>block_size</code>
+     * in direct mode.
+     */
+    std::size_t buffer_size = 0;
+    /**
+     * Access pattern hint for the whole file.
+     */
+    fd_advice advice = fd_advice::normal;
+    /**
+     * If not zero the device keeps asking the kernel to read ahead this
+     * many bytes past the current read position
+     * (<code>POSIX_FADV_WILLNEED</code>).
+     */
+    std::size_t readahead = 0;
+    /**
+     * Call <code>fdatasync</code> on every flush.
+     */
+    bool sync_on_flush = false;
+};
+
+/**
+ * File descriptor device.
+ *
+ * The device is nova::source and nova::sink at the same time, so it can be
+ * shared between nova::device_instream and nova::device_outstream. For
+ * regular files reading starts at the beginning of the file and writing
+ * appends to its end (after optional truncation) with independent
+ * positions; for pipes and sockets the descriptor is used as is.
+ *
+ * Open modes follow <code>std::fopen</code>: <code>out</code> without
+ * <code>in</code> or <code>app</code> truncates the file, <code>trunc</code>
+ * always does.
+ *
+ * Errors are reported the same way as by the standard streams: failed
+ * <code>read</code> returns 0 and failed <code>write</code> returns less
+ * than requested, which puts the stream into failed state. The
+ * <code>errno</code> value of the last failure is available from
+ * <code>error()</code>.
+ *
+ * In direct mode the output is written in multiples of
+ * <code>fd_params::block_size</code>; the incomplete last block is written
+ * on <code>close</code> after <code>O_DIRECT</code> is cleared from the
+ * descriptor. Appending in direct mode requires the file size to be a
+ * multiple of the block size, otherwise the descriptor falls back to
+ * regular I/O.
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_fd_device
+{
+public:
+    typedef CharT  char_type;
+    typedef source in_category;
+    typedef sink   out_category;
+
+    /**
+     * Opens the file.
+     *
+     * @param path file name
+     * @param mode combination of <code>std::ios_base::in</code>,
+     *             <code>out</code>, <code>app</code> and <code>trunc</code>
+     * @param params tuning parameters
+     */
+    explicit basic_fd_device(const std::string& path,
+                             std::ios_base::openmode mode = std::ios_base::in,
+                             const fd_params& params = fd_params{}) : _params{params}
+    {
+        bool readable = (mode & std::ios_base::in) != 0;
+        bool writable = (mode & std::ios_base::out) || (mode & std::ios_base::app);
+        bool truncate = (mode & std::ios_base::trunc) || (writable && !readable && !(mode & std::ios_base::app));
+        int flags = readable && writable ? O_RDWR : writable ? O_WRONLY : O_RDONLY;
+        if (writable) flags |= O_CREAT;
+        if (truncate) flags |= O_TRUNC;
+        flags |= O_CLOEXEC;
+#ifdef O_DIRECT
+        if (_params.direct)
+        {
+            do _fd = ::open(path.c_str(), flags | O_DIRECT, 0644); while (_fd < 0 && errno == EINTR);
+            _direct = _fd >= 0;
+        }
+#endif
+        if (_fd < 0) do _fd = ::open(path.c_str(), flags, 0644); while (_fd < 0 && errno == EINTR);
+        if (_fd < 0)
+        {
+            _error = errno;
+            return;
+        }
+        _owns_fd = true;
+        init();
+    }
+
+    /**
+     * Wraps already opened file descriptor.
+     *
+     * @param fd file descriptor
+     * @param owns_fd whether the descriptor is closed together with the device
+     * @param params tuning parameters
+     */
+    basic_fd_device(int fd, bool owns_fd, const fd_params& params = fd_params{}) :
+            _params{params}, _fd{fd}, _owns_fd{owns_fd}
+    {
+#ifdef O_DIRECT
+        if (_params.direct)
+        {
+            int flags = ::fcntl(_fd, F_GETFL);
+            _direct = flags >= 0 && ((flags & O_DIRECT) || ::fcntl(_fd, F_SETFL, flags | O_DIRECT) == 0);
+        }
+#endif
+        init();
+    }
+
+    basic_fd_device(const basic_fd_device& ) = delete;
+    basic_fd_device& operator=(const basic_fd_device& ) = delete;
+
+    ~basic_fd_device() noexcept { close(); }
+
+    /**
+     * @return <code>true</code> if the descriptor is open.
+     */
+    bool is_open() const { return _fd >= 0; }
+    /**
+     * @return <code>true</code> if the descriptor is in <code>O_DIRECT</code> mode.
+     */
+    bool direct() const { return _direct; }
+    /**
+     * @return <code>errno</code> of the last failed operation or 0.
+     */
+    int error() const { return _error; }
+    /**
+     * @return the underlying file descriptor.
+     */
+    int fd() const { return _fd; }
+
+    /**
+     * Writes pending output and closes the descriptor if it is owned by
+     * the device.
+     */
+    void close() noexcept
+    {
+        if (_fd < 0) return;
+        write_pending(true);
+        if (_owns_fd) ::close(_fd);
+        _fd = -1;
+        release(_out_buf);
+        release(_in_buf);
+    }
+
+    /* source function */
+    std::streamsize read(char_type* s, std::streamsize n)
+    {
+        auto dst = reinterpret_cast<char*>(s);
+        std::size_t size = static_cast<std::size_t>(n) * sizeof(char_type);
+        std::size_t done = 0;
+        /* The loop only repeats to complete a partially read multi-byte character. */
+        do
+        {
+            std::size_t read = _direct ? read_staged(dst + done, size - done) : sys_read(dst + done, size - done);
+            if (read == 0) break;
+            done += read;
+        }
+        while (done % sizeof(char_type) != 0);
+        return static_cast<std::streamsize>(done / sizeof(char_type));
+    }
+
+    /* sink functions */
+    std::streamsize write(const char_type* s, std::streamsize n)
+    {
+        auto src = reinterpret_cast<const char*>(s);
+        std::size_t size = static_cast<std::size_t>(n) * sizeof(char_type);
+        if (_out_capacity == 0) return static_cast<std::streamsize>(write_all(src, size) / sizeof(char_type));
+        if (!_out_buf) _out_buf = allocate(_out_capacity);
+        if (_out_size + size < _out_capacity || _direct)
+        {
+            std::size_t done = 0;
+            while (done < size)
+            {
+                std::size_t chunk = std::min(size - done, _out_capacity - _out_size);
+                std::memcpy(_out_buf + _out_size, src + done, chunk);
+                _out_size += chunk;
+                done += chunk;
+                if (_out_size == _out_capacity && !write_pending(false)) break;
+            }
+            return static_cast<std::streamsize>(done / sizeof(char_type));
+        }
+        /* Pending output and the caller's block go out in one gathered write
+         * without copying the block. */
+        iovec iov[2] = {{_out_buf, _out_size}, {const_cast<char*>(src), size}};
+        std::size_t pending = _out_size;
+        std::size_t written = write_all(iov, 2);
+        keep_unwritten(written);
+        return written < pending ? 0 : static_cast<std::streamsize>((written - pending) / sizeof(char_type));
+    }
+
+    /**
+     * Writes the spans in order with one gathered <code>writev</code>,
+     * preceded by the pending output (see nova::sink). In direct mode the
+     * spans are written one by one.
+     */
+    std::streamsize write_v(const std::pair<const char_type*, std::size_t>* spans, int count)
+    {
+        std::streamsize total = 0;
+        if (_direct)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                auto size = static_cast<std::streamsize>(spans[i].second);
+                std::streamsize written = write(spans[i].first, size);
+                total += written;
+                if (written < size) break;
+            }
+            return total;
+        }
+        static constexpr int max_spans = 16;
+        iovec iov[max_spans + 1];
+        while (count > 0)
+        {
+            int n = 0;
+            std::size_t pending = _out_size;
+            if (pending > 0) iov[n++] = {_out_buf, pending};
+            int chunk = std::min(count, max_spans);
+            std::size_t size = 0;
+            for (int i = 0; i < chunk; ++i)
+            {
+                iov[n++] = {const_cast<char_type*>(spans[i].first), spans[i].second * sizeof(char_type)};
+                size += spans[i].second * sizeof(char_type);
+            }
+            std::size_t written = write_all(iov, n);
+            keep_unwritten(written);
+            if (written < pending + size)
+            {
+                if (written > pending) total += static_cast<std::streamsize>((written - pending) / sizeof(char_type));
+                break;
+            }
+            total += static_cast<std::streamsize>(size / sizeof(char_type));
+            spans += chunk;
+            count -= chunk;
+        }
+        return total;
+    }
+
+    void flush()
+    {
+        if (_fd < 0) return;
+        write_pending(false);
+        if (_params.sync_on_flush) ::fdatasync(_fd);
+    }
+
+    /**
+     * Moves read or write position. The device keeps separate positions
+     * for reading and writing. Pending output is written before the write
+     * position is moved.
+     *
+     * @param off offset in characters
+     * @param dir direction of the offset
+     * @param which <code>std::ios_base::in</code> or <code>std::ios_base::out</code>
+     * @return new position in characters or -1 if the descriptor is not seekable.
+     */
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+    {
+        if (_fd < 0 || !_seekable) return -1;
+        bool in = which & std::ios_base::in;
+        if (!in && !write_pending(true)) return -1;
+        off_t base = 0;
+        if (dir == std::ios_base::cur)
+        {
+            base = in ? _in_pos - static_cast<off_t>(_in_end - _in_begin) : _out_pos;
+        }
+        else if (dir == std::ios_base::end)
+        {
+            struct stat st{};
+            if (::fstat(_fd, &st) != 0)
+            {
+                _error = errno;
+                return -1;
+            }
+            base = std::max(st.st_size, _out_pos + static_cast<off_t>(_out_size));
+        }
+        off_t target = base + static_cast<off_t>(off) * static_cast<off_t>(sizeof(char_type));
+        if (target < 0) return -1;
+        auto block = static_cast<off_t>(_params.block_size);
+        if (in)
+        {
+            _in_begin = _in_end = 0;
+            _in_pos = target;
+            if (_direct && target % block != 0)
+            {
+                /* O_DIRECT reads must start at a block boundary: read the whole
+                 * block and skip its head. */
+                _in_pos = target - target % block;
+                std::size_t skip = static_cast<std::size_t>(target % block);
+                fill_staged();
+                _in_begin = std::min(skip, _in_end);
+            }
+        }
+        else
+        {
+            if (_direct && target % block != 0) drop_direct();
+            _out_pos = target;
+        }
+        return static_cast<std::streamoff>(target) / static_cast<std::streamoff>(sizeof(char_type));
+    }
+
+private:
+    void init()
+    {
+        _seekable = ::lseek(_fd, 0, SEEK_CUR) >= 0;
+        if (_seekable)
+        {
+            _in_pos = 0;
+            _out_pos = ::lseek(_fd, 0, SEEK_END);
+        }
+        if (_params.buffer_size == 0 && _direct) _params.buffer_size = 1 << 20;
+        if (_direct)
+        {
+            std::size_t block = _params.block_size;
+            _params.buffer_size = (_params.buffer_size + block - 1) / block * block;
+            if (_seekable && _out_pos % static_cast<off_t>(block) != 0) drop_direct();
+        }
+        _out_capacity = _params.buffer_size;
+#if defined(POSIX_FADV_NORMAL)
+        static constexpr int advices[] = {POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL,
+                                          POSIX_FADV_RANDOM, POSIX_FADV_NOREUSE};
+        if (_params.advice != fd_advice::normal)
+        {
+            ::posix_fadvise(_fd, 0, 0, advices[static_cast<int>(_params.advice)]);
+        }
+#endif
+    }
+
+    char* allocate(std::size_t size)
+    {
+        return static_cast<char*>(::operator new(size, std::align_val_t{_params.block_size}));
+    }
+    void release(char*& buf) noexcept
+    {
+        if (buf) ::operator delete(buf, std::align_val_t{_params.block_size});
+        buf = nullptr;
+    }
+
+    void drop_direct()
+    {
+#ifdef O_DIRECT
+        int flags = ::fcntl(_fd, F_GETFL);
+        if (flags >= 0) ::fcntl(_fd, F_SETFL, flags & ~O_DIRECT);
+#endif
+        _direct = false;
+    }
+
+    bool fill_staged()
+    {
+        if (!_in_buf) _in_buf = allocate(_params.buffer_size);
+        _in_begin = _in_end = 0;
+        _in_end = sys_read(_in_buf, _params.buffer_size);
+        return _in_end > 0;
+    }
+
+    std::size_t read_staged(char* s, std::size_t n)
+    {
+        if (_in_begin == _in_end && !fill_staged()) return 0;
+        std::size_t chunk = std::min(n, _in_end - _in_begin);
+        std::memcpy(s, _in_buf + _in_begin, chunk);
+        _in_begin += chunk;
+        return chunk;
+    }
+
+    std::size_t sys_read(char* s, std::size_t n)
+    {
+        if (_fd < 0) return 0;
+        ssize_t res;
+        do res = _seekable ? ::pread(_fd, s, n, _in_pos) : ::read(_fd, s, n);
+        while (res < 0 && errno == EINTR);
+        if (res < 0)
+        {
+            _error = errno;
+            return 0;
+        }
+        _in_pos += res;
+#if defined(POSIX_FADV_WILLNEED)
+        if (_params.readahead > 0 && _seekable && _in_pos + static_cast<off_t>(_params.readahead / 2) > _advised_to)
+        {
+            ::posix_fadvise(_fd, _in_pos, static_cast<off_t>(_params.readahead), POSIX_FADV_WILLNEED);
+            _advised_to = _in_pos + static_cast<off_t>(_params.readahead);
+        }
+#endif
+        return static_cast<std::size_t>(res);
+    }
+
+    std::size_t write_all(const char* s, std::size_t n)
+    {
+        iovec iov{const_cast<char*>(s), n};
+        return write_all(&iov, 1);
+    }
+
+    std::size_t write_all(iovec* iov, int count)
+    {
+        if (_fd < 0) return 0;
+        std::size_t total = 0;
+        while (count > 0)
+        {
+            ssize_t res = _seekable ? ::pwritev(_fd, iov, count, _out_pos) : ::writev(_fd, iov, count);
+            if (res < 0)
+            {
+                if (errno == EINTR) continue;
+                _error = errno;
+                break;
+            }
+            if (res == 0) break;
+            _out_pos += res;
+            total += static_cast<std::size_t>(res);
+            /* Short write: skip what went out and retry the rest. */
+            auto written = static_cast<std::size_t>(res);
+            for (; count > 0 && written >= iov->iov_len; ++iov, --count) written -= iov->iov_len;
+            if (count > 0)
+            {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+        return total;
+    }
+
+    bool write_pending(bool all)
+    {
+        if (_out_size == 0) return true;
+        std::size_t size = _out_size;
+        if (_direct)
+        {
+            std::size_t block = _params.block_size;
+            if (all && size % block != 0) drop_direct();
+            else size -= size % block;
+        }
+        std::size_t written = write_all(_out_buf, size);
+        keep_unwritten(written);
+        return written == size;
+    }
+
+    /* Removes the first written bytes from the pending output; the part
+     * which did not go out stays pending. */
+    void keep_unwritten(std::size_t written)
+    {
+        if (written >= _out_size)
+        {
+            _out_size = 0;
+            return;
+        }
+        std::memmove(_out_buf, _out_buf + written, _out_size - written);
+        _out_size -= written;
+    }
+
+    fd_params _params;
+    int _fd = -1;
+    bool _owns_fd = false;
+    bool _direct = false;
+    bool _seekable = false;
+    int _error = 0;
+    off_t _in_pos = 0;
+    off_t _out_pos = 0;
+    off_t _advised_to = 0;
+    char* _out_buf = nullptr;
+    std::size_t _out_size = 0;
+    std::size_t _out_capacity = 0;
+    char* _in_buf = nullptr;
+    std::size_t _in_begin = 0;
+    std::size_t _in_end = 0;
+};
+
+/**
+ * File source: nova::basic_fd_device opened for reading which can be used
+ * directly with nova::instream.
+ *
+ * ~~~~~{.cpp}
+ * nova::instream<nova::file_source, nova::buffer_8k> in{"data.log"};
+ * ~~~~~
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_file_source : private basic_fd_device<CharT>
+{
+    typedef basic_fd_device<CharT> _device_type;
+public:
+    typedef CharT  char_type;
+    typedef source category;
+
+    explicit basic_file_source(const std::string& path, const fd_params& params = fd_params{}) :
+            _device_type{path, std::ios_base::in, params} {}
+    basic_file_source(int fd, bool owns_fd, const fd_params& params = fd_params{}) :
+            _device_type{fd, owns_fd, params} {}
+
+    using _device_type::is_open;
+    using _device_type::direct;
+    using _device_type::error;
+    using _device_type::fd;
+    using _device_type::close;
+    using _device_type::read;
+
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir)
+    {
+        return _device_type::seek(off, dir, std::ios_base::in);
+    }
+};
+
+/**
+ * File sink: nova::basic_fd_device opened for writing which can be used
+ * directly with nova::outstream.
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<nova::file_sink, nova::buffer_8k> out{"data.log"};
+ * ~~~~~
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_file_sink : private basic_fd_device<CharT>
+{
+    typedef basic_fd_device<CharT> _device_type;
+public:
+    typedef CharT char_type;
+    typedef sink  category;
+
+    explicit basic_file_sink(const std::string& path,
+                             std::ios_base::openmode mode = std::ios_base::out,
+                             const fd_params& params = fd_params{}) :
+            _device_type{path, mode | std::ios_base::out, params} {}
+    basic_file_sink(int fd, bool owns_fd, const fd_params& params = fd_params{}) :
+            _device_type{fd, owns_fd, params} {}
+
+    using _device_type::is_open;
+    using _device_type::direct;
+    using _device_type::error;
+    using _device_type::fd;
+    using _device_type::close;
+    using _device_type::write;
+    using _device_type::write_v;
+    using _device_type::flush;
+
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir)
+    {
+        return _device_type::seek(off, dir, std::ios_base::out);
+    }
+};
+
+#ifdef __linux__
+/**
+ * Copies up to <code>n</code> characters from the file source to the file
+ * sink inside the kernel, used by nova::copy. The data goes with
+ * <code>copy_file_range</code> between files, <code>splice</code> when
+ * either side is a pipe and <code>sendfile</code> from a file to a socket.
+ * The positions of the source and the sink advance by the number of
+ * characters copied: pipes and sockets in the kernel, files through
+ * <code>seek</code>.
+ *
+ * Only available on Linux. Returns -1 for characters larger than a byte
+ * and in <code>O_DIRECT</code> mode.
+ *
+ * @param source file source
+ * @param sink file sink
+ * @param n maximum number of characters to copy
+ * @return number of characters copied, 0 at the end of the source or -1 if
+ *         the descriptors do not allow copying in the kernel.
+ */
+template<typename CharT>
+std::streamsize transfer(basic_file_source<CharT>& source, basic_file_sink<CharT>& sink, std::streamsize n)
+{
+    if (sizeof(CharT) != 1 || !source.is_open() || !sink.is_open() || source.direct() || sink.direct()) return -1;
+    /* Pending output of the sink goes first. */
+    sink.flush();
+    const loff_t in_start = source.seek(0, std::ios_base::cur);
+    const loff_t out_start = sink.seek(0, std::ios_base::cur);
+    /* The kernel advances these, the devices are moved afterwards. */
+    loff_t in_pos = in_start;
+    loff_t out_pos = out_start;
+    loff_t* in_off = in_start >= 0 ? &in_pos : nullptr;
+    loff_t* out_off = out_start >= 0 ? &out_pos : nullptr;
+    auto size = static_cast<std::size_t>(n);
+    struct stat in_st{}, out_st{};
+    if (::fstat(source.fd(), &in_st) != 0 || ::fstat(sink.fd(), &out_st) != 0) return -1;
+    ssize_t res = -1;
+    if (S_ISFIFO(in_st.st_mode) || S_ISFIFO(out_st.st_mode))
+    {
+        do res = ::splice(source.fd(), in_off, sink.fd(), out_off, size, SPLICE_F_MOVE);
+        while (res < 0 && errno == EINTR);
+    }
+    else if (S_ISREG(in_st.st_mode) && S_ISREG(out_st.st_mode))
+    {
+        do res = ::copy_file_range(source.fd(), in_off, sink.fd(), out_off, size, 0);
+        while (res < 0 && errno == EINTR);
+    }
+    else if (S_ISREG(in_st.st_mode) && !out_off)
+    {
+        auto off = static_cast<off_t>(in_start);
+        do res = ::sendfile(sink.fd(), source.fd(), &off, size);
+        while (res < 0 && errno == EINTR);
+    }
+    if (res < 0) return -1;
+    if (in_off) source.seek(in_start + res, std::ios_base::beg);
+    if (out_off) sink.seek(out_start + res, std::ios_base::beg);
+    return static_cast<std::streamsize>(res);
+}
+#endif
+
+/**
+ * Type definition for file descriptor device of <code>char</code>.
+ */
+typedef basic_fd_device<char>   fd_device;
+/**
+ * Type definition for file source of <code>char</code>.
+ */
+typedef basic_file_source<char> file_source;
+/**
+ * Type definition for file sink of <code>char</code>.
+ */
+typedef basic_file_sink<char>   file_sink;
+
+} // end of nova namespace
+
+#endif // NOVA_FD_DEVICE_H
@@ -0,0 +1,524 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_FILTER_H
+#define NOVA_FILTER_H
+
+#include <nova/io.h>
+
+#include <cstdint>
+
+/**
+ * @file filter.h
+ * @brief Compile time filter chains between streams and sinks or sources.
+ *
+ * Filters are stacked at compile time, so every call through the chain is
+ * a direct (and usually inlined) call. The streams write into and read from
+ * a buffer owned by the chain, and the filters always see whole buffers
+ * rather than single characters.
+ *
+ * ~~~~~{.cpp}
+ * nova::filtered_outstream<nova::file_sink, nova::crc32c_filter> out{"data.log"};
+ * out << "payload";
+ * out.flush();
+ * std::uint32_t crc = out->filter<nova::crc32c_filter>().value();
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Filter tag.
+ *
+ * Object with this tag can be put into nova::filtered_sink or
+ * nova::filtered_source. It is expected to have the following type
+ * definitions:
+ *
+ * ~~~~~{.cpp}
+ * typedef <character type> char_type;
+ * typedef filter category;
+ * ~~~~~
+ *
+ * Output filters have the following methods:
+ *
+ * ~~~~~{.cpp}
+ * template<typename Next> std::streamsize write(Next& next, const CharT* s, std::streamsize n);
+ * template<typename Next> void flush(Next& next);
+ * ~~~~~
+ *
+ * Method <code>write</code> processes <code>n</code> characters from
+ * <code>s</code>, passes the result on with <code>next.write(...)</code>
+ * and returns the number of characters consumed. Method
+ * <code>flush</code> passes on anything the filter has been holding back;
+ * <code>next</code> is flushed by the chain afterwards.
+ *
+ * Output filter may also have the method
+ *
+ * ~~~~~{.cpp}
+ * template<typename Next> void close(Next& next);
+ * ~~~~~
+ *
+ * which is called once, when the chain is closed or destroyed, to write
+ * the end of the filtered data (e.g. compression trailer).
+ *
+ * Input filters have the following method:
+ *
+ * ~~~~~{.cpp}
+ * template<typename Prev> std::streamsize read(Prev& prev, CharT* s, std::streamsize n);
+ * ~~~~~
+ *
+ * Method <code>read</code> obtains data with <code>prev.read(...)</code>,
+ * places up to <code>n</code> processed characters into <code>s</code> and
+ * returns their number, 0 meaning end of data.
+ *
+ * A filter may implement both directions.
+ */
+struct filter {};
+
+template<typename Filter, typename Next, typename = void>
+struct has_filter_close : std::false_type {};
+
+template<typename Filter, typename Next>
+struct has_filter_close<Filter, Next,
+                        std::void_t<decltype(std::declval<Filter&>().close(std::declval<Next&>()))>> : std::true_type {};
+
+template<typename Sink, typename... Filters>
+class filter_chain_sink;
+
+template<typename Sink>
+class filter_chain_sink<Sink>
+{
+public:
+    typedef typename Sink::char_type char_type;
+
+    template<typename... Args>
+    explicit filter_chain_sink(Args&&... args) : _sink{std::forward<Args>(args)...} {}
+
+    std::streamsize write(const char_type* s, std::streamsize n) { return write(s, n, typename Sink::category{}); }
+    void flush() { flush(typename Sink::category{}); }
+    void close() { flush(); }
+
+    Sink& sink() { return _sink; }
+    const Sink& sink() const { return _sink; }
+
+private:
+    std::streamsize write(const char_type* s, std::streamsize n, nova::sink) { return _sink.write(s, n); }
+    void flush(nova::sink) { _sink.flush(); }
+
+    std::streamsize write(const char_type* s, std::streamsize n, out_buffer_provider)
+    {
+        std::streamsize done = 0;
+        while (done < n)
+        {
+            if (_size == _used)
+            {
+                auto res = _sink.get_out_buffer();
+                if (!res.first || res.second <= 0) break;
+                _buffer = res.first;
+                _size = res.second;
+                _used = _flushed = 0;
+            }
+            std::size_t chunk = _size - _used;
+            if (static_cast<std::streamsize>(chunk) > n - done) chunk = static_cast<std::size_t>(n - done);
+            std::char_traits<char_type>::copy(_buffer + _used, s + done, chunk);
+            _used += chunk;
+            done += static_cast<std::streamsize>(chunk);
+        }
+        return done;
+    }
+    void flush(out_buffer_provider)
+    {
+        _sink.flush(_used - _flushed);
+        _flushed = _used;
+    }
+
+    Sink _sink;
+    char_type* _buffer = nullptr;
+    std::size_t _size = 0;
+    std::size_t _used = 0;
+    std::size_t _flushed = 0;
+};
+
+template<typename Sink, typename Filter, typename... Filters>
+class filter_chain_sink<Sink, Filter, Filters...>
+{
+public:
+    typedef typename Sink::char_type char_type;
+
+    template<typename... Args>
+    explicit filter_chain_sink(Args&&... args) : _next{std::forward<Args>(args)...} {}
+
+    ~filter_chain_sink() noexcept { close(); }
+
+    std::streamsize write(const char_type* s, std::streamsize n) { return _filter.write(_next, s, n); }
+    void flush()
+    {
+        _filter.flush(_next);
+        _next.flush();
+    }
+    void close()
+    {
+        if (_closed) return;
+        _closed = true;
+        if constexpr (has_filter_close<Filter, filter_chain_sink<Sink, Filters...>>::value) _filter.close(_next);
+        else _filter.flush(_next);
+        _next.close();
+    }
+
+    Sink& sink() { return _next.sink(); }
+    const Sink& sink() const { return _next.sink(); }
+
+    template<typename F>
+    F& get() { if constexpr (std::is_same<F, Filter>::value) return _filter; else return _next.template get<F>(); }
+    template<typename F>
+    const F& get() const { if constexpr (std::is_same<F, Filter>::value) return _filter; else return _next.template get<F>(); }
+
+private:
+    Filter _filter;
+    filter_chain_sink<Sink, Filters...> _next;
+    bool _closed = false;
+};
+
+template<typename Source, typename... Filters>
+class filter_chain_source;
+
+template<typename Source>
+class filter_chain_source<Source>
+{
+public:
+    typedef typename Source::char_type char_type;
+
+    template<typename... Args>
+    explicit filter_chain_source(Args&&... args) : _source{std::forward<Args>(args)...} {}
+
+    std::streamsize read(char_type* s, std::streamsize n) { return read(s, n, typename Source::category{}); }
+
+    Source& source() { return _source; }
+    const Source& source() const { return _source; }
+
+private:
+    std::streamsize read(char_type* s, std::streamsize n, nova::source) { return _source.read(s, n); }
+
+    std::streamsize read(char_type* s, std::streamsize n, in_buffer_provider)
+    {
+        if (_begin == _end)
+        {
+            auto res = _source.get_in_buffer();
+            if (!res.first || res.second <= 0) return 0;
+            _begin = res.first;
+            _end = res.first + res.second;
+        }
+        std::streamsize chunk = _end - _begin < n ? _end - _begin : n;
+        std::char_traits<char_type>::copy(s, _begin, static_cast<std::size_t>(chunk));
+        _begin += chunk;
+        return chunk;
+    }
+
+    Source _source;
+    const char_type* _begin = nullptr;
+    const char_type* _end = nullptr;
+};
+
+template<typename Source, typename Filter, typename... Filters>
+class filter_chain_source<Source, Filter, Filters...>
+{
+public:
+    typedef typename Source::char_type char_type;
+
+    template<typename... Args>
+    explicit filter_chain_source(Args&&... args) : _prev{std::forward<Args>(args)...} {}
+
+    std::streamsize read(char_type* s, std::streamsize n) { return _filter.read(_prev, s, n); }
+
+    Source& source() { return _prev.source(); }
+    const Source& source() const { return _prev.source(); }
+
+    template<typename F>
+    F& get() { if constexpr (std::is_same<F, Filter>::value) return _filter; else return _prev.template get<F>(); }
+    template<typename F>
+    const F& get() const { if constexpr (std::is_same<F, Filter>::value) return _filter; else return _prev.template get<F>(); }
+
+private:
+    Filter _filter;
+    filter_chain_source<Source, Filters...> _prev;
+};
+
+/**
+ * Output buffer provider which passes everything written to it through
+ * the chain of <code>Filters</code> into <code>Sink</code>.
+ *
+ * The stream writes directly into the buffer of this object; the filters
+ * are called with the whole buffer when it is full and with whatever was
+ * written so far when the stream is flushed. Data flows from the first
+ * filter in the list to the last one and then to <code>Sink</code>, which
+ * can be either nova::sink or nova::out_buffer_provider.
+ *
+ * Usually used through nova::filtered_outstream.
+ *
+ * @tparam Sink final sink
+ * @tparam Filters output filters, see nova::filter
+ */
+template<typename Sink, typename... Filters>
+class filtered_sink
+{
+public:
+    typedef typename Sink::char_type char_type;
+    typedef out_buffer_provider      category;
+
+    /**
+     * Size of the buffer the filters are called with.
+     */
+    static constexpr std::size_t buffer_size = 8192;
+
+    /**
+     * Constructor. Filters are default constructed.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template<typename... Args>
+    explicit filtered_sink(Args&&... args) : _chain{std::forward<Args>(args)...} {}
+
+    filtered_sink(const filtered_sink& ) = delete;
+    filtered_sink& operator=(const filtered_sink& ) = delete;
+
+    /* out_buffer_provider functions */
+    std::pair<char_type*, std::size_t> get_out_buffer()
+    {
+        /* The stream only asks for the next buffer when the previous one is full. */
+        if (_provided && !pass(buffer_size - _begin)) return {nullptr, 0};
+        _provided = true;
+        _begin = 0;
+        return {_buffer, buffer_size};
+    }
+
+    void flush(std::size_t size)
+    {
+        if (pass(size)) _chain.flush();
+    }
+
+    /**
+     * Closes the filter chain: every filter writes the end of its data and
+     * the sink is flushed. The stream should be flushed before this call;
+     * nothing can be written afterwards. Called automatically on
+     * destruction.
+     */
+    void close() { _chain.close(); }
+
+    /**
+     * @return reference to the final <code>Sink</code>.
+     */
+    Sink& sink() { return _chain.sink(); }
+    /**
+     * @return const reference to the final <code>Sink</code>.
+     */
+    const Sink& sink() const { return _chain.sink(); }
+
+    /**
+     * @tparam F type of the filter
+     * @return reference to the filter of type <code>F</code> in the chain.
+     */
+    template<typename F>
+    F& filter() { return _chain.template get<F>(); }
+    /**
+     * @tparam F type of the filter
+     * @return const reference to the filter of type <code>F</code> in the chain.
+     */
+    template<typename F>
+    const F& filter() const { return _chain.template get<F>(); }
+
+    /**
+     * @return <code>false</code> if the chain failed to accept data.
+     */
+    bool good() const { return _good; }
+
+private:
+    bool pass(std::size_t size)
+    {
+        if (size == 0) return _good;
+        auto n = static_cast<std::streamsize>(size);
+        _good = _good && _chain.write(_buffer + _begin, n) == n;
+        _begin += size;
+        return _good;
+    }
+
+    filter_chain_sink<Sink, Filters...> _chain;
+    char_type _buffer[buffer_size];
+    std::size_t _begin = 0;
+    bool _provided = false;
+    bool _good = true;
+};
+
+/**
+ * Input buffer provider which reads from <code>Source</code> through the
+ * chain of <code>Filters</code>.
+ *
+ * Every call to <code>get_in_buffer</code> fills the buffer of this object
+ * with one read through the chain. Data flows from <code>Source</code>
+ * (either nova::source or nova::in_buffer_provider) to the last filter in
+ * the list and then up to the first one, which is the closest to the
+ * stream.
+ *
+ * Usually used through nova::filtered_instream.
+ *
+ * @tparam Source original source
+ * @tparam Filters input filters, see nova::filter
+ */
+template<typename Source, typename... Filters>
+class filtered_source
+{
+public:
+    typedef typename Source::char_type char_type;
+    typedef in_buffer_provider         category;
+
+    /**
+     * Size of the buffer the filters are called with.
+     */
+    static constexpr std::size_t buffer_size = 8192;
+
+    /**
+     * Constructor. Filters are default constructed.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Source</code>
+     */
+    template<typename... Args>
+    explicit filtered_source(Args&&... args) : _chain{std::forward<Args>(args)...} {}
+
+    filtered_source(const filtered_source& ) = delete;
+    filtered_source& operator=(const filtered_source& ) = delete;
+
+    /* in_buffer_provider function */
+    std::pair<const char_type*, std::size_t> get_in_buffer()
+    {
+        std::streamsize n = _chain.read(_buffer, static_cast<std::streamsize>(buffer_size));
+        if (n <= 0) return {nullptr, 0};
+        return {_buffer, static_cast<std::size_t>(n)};
+    }
+
+    /**
+     * @return reference to the original <code>Source</code>.
+     */
+    Source& source() { return _chain.source(); }
+    /**
+     * @return const reference to the original <code>Source</code>.
+     */
+    const Source& source() const { return _chain.source(); }
+
+    /**
+     * @tparam F type of the filter
+     * @return reference to the filter of type <code>F</code> in the chain.
+     */
+    template<typename F>
+    F& filter() { return _chain.template get<F>(); }
+    /**
+     * @tparam F type of the filter
+     * @return const reference to the filter of type <code>F</code> in the chain.
+     */
+    template<typename F>
+    const F& filter() const { return _chain.template get<F>(); }
+
+private:
+    filter_chain_source<Source, Filters...> _chain;
+    char_type _buffer[buffer_size];
+};
+
+/**
+ * Type definition for output stream writing to <code>Sink</code> through
+ * the chain of <code>Filters</code>.
+ *
+ * @tparam Sink final sink, nova::sink or nova::out_buffer_provider
+ * @tparam Filters output filters, the first one is the closest to the stream
+ *
+ * @see filtered_sink
+ */
+template<typename Sink, typename... Filters>
+using filtered_outstream = outstream<filtered_sink<Sink, Filters...>>;
+
+/**
+ * Type definition for input stream reading from <code>Source</code> through
+ * the chain of <code>Filters</code>.
+ *
+ * @tparam Source original source, nova::source or nova::in_buffer_provider
+ * @tparam Filters input filters, the first one is the closest to the stream
+ *
+ * @see filtered_source
+ */
+template<typename Source, typename... Filters>
+using filtered_instream = instream<filtered_source<Source, Filters...>>;
+
+/**
+ * CRC-32C (Castagnoli) checksum filter.
+ *
+ * Passes the data through unchanged in both directions and keeps the
+ * checksum of everything it has seen.
+ */
+class crc32c_filter
+{
+public:
+    typedef char   char_type;
+    typedef filter category;
+
+    template<typename Next>
+    std::streamsize write(Next& next, const char_type* s, std::streamsize n)
+    {
+        std::streamsize written = next.write(s, n);
+        if (written > 0) update(s, static_cast<std::size_t>(written));
+        return written;
+    }
+
+    template<typename Next>
+    void flush(Next& ) { }
+
+    template<typename Prev>
+    std::streamsize read(Prev& prev, char_type* s, std::streamsize n)
+    {
+        std::streamsize read = prev.read(s, n);
+        if (read > 0) update(s, static_cast<std::size_t>(read));
+        return read;
+    }
+
+    /**
+     * @return checksum of the data passed so far.
+     */
+    std::uint32_t value() const { return ~_crc; }
+    /**
+     * Restarts the checksum.
+     */
+    void reset() { _crc = 0xFFFFFFFFu; }
+
+private:
+    void update(const char_type* s, std::size_t n)
+    {
+        auto p = reinterpret_cast<const unsigned char*>(s);
+        std::uint32_t crc = _crc;
+        for (std::size_t i = 0; i < n; ++i) crc = table()[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        _crc = crc;
+    }
+
+    static const std::uint32_t* table()
+    {
+        static const struct crc_table
+        {
+            std::uint32_t entries[256];
+            crc_table() : entries{}
+            {
+                for (std::uint32_t i = 0; i < 256; ++i)
+                {
+                    std::uint32_t crc = i;
+                    for (int k = 0; k < 8; ++k) crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+                    entries[i] = crc;
+                }
+            }
+        } t;
+        return t.entries;
+    }
+
+    std::uint32_t _crc = 0xFFFFFFFFu;
+};
+
+} // end of nova namespace
+
+#endif // NOVA_FILTER_H
@@ -10,6 +10,11 @@ http://boost.org/LICENSE_1_0.txt
 
 #include <type_traits>
 #include <iostream>
+#include <climits>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
 
 /**
  * @file io.h
@@ -29,7 +34,24 @@ namespace nova {
 /**
  * Template class holder of the buffer size.
  *
+ * This is also the simplest buffering policy. Any type with the following
+ * methods can be used as <code>Buffering</code> parameter of
+ * nova::outstream and nova::instream:
+ *
+ * ~~~~~{.cpp}
+ * std::size_t size() const;
+ * std::size_t next_size(std::size_t used);
+ * ~~~~~
+ *
+ * Method <code>size</code> returns the current buffer size. Method
+ * <code>next_size</code> is called every time the buffer is written to the
+ * sink or refilled from the source with the number of characters which went
+ * through it and returns the buffer size to use from then on.
+ *
  * @tparam BufSize buffer size
+ *
+ * @see dynamic_buffering
+ * @see adaptive_buffering
  */
 template<std::size_t BufSize>
 struct buffering
@@ -38,6 +60,123 @@ struct buffering
      * Size of buffer as constant expression.
      */
     static constexpr std::size_t buf_size = BufSize;
+
+    /**
+     * @return buffer size.
+     */
+    constexpr std::size_t size() const { return BufSize; }
+    /**
+     * @return buffer size, which never changes.
+     */
+    constexpr std::size_t next_size(std::size_t ) const { return BufSize; }
+};
+
+/**
+ * Buffering policy with the buffer size chosen at run time.
+ *
+ * The policy object is passed as the first argument of the stream
+ * constructor, followed by the arguments for the sink or source:
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<nova::file_sink, nova::dynamic_buffering> out{nova::dynamic_buffering{64 << 10}, "data.log"};
+ * ~~~~~
+ *
+ * @see buffering
+ */
+class dynamic_buffering
+{
+public:
+    /**
+     * @param size buffer size, at least 1.
+     */
+    explicit dynamic_buffering(std::size_t size = 8192) : _size{size > 0 ? size : 1} {}
+
+    /**
+     * @return buffer size.
+     */
+    std::size_t size() const { return _size; }
+    /**
+     * @return buffer size, which never changes.
+     */
+    std::size_t next_size(std::size_t ) const { return _size; }
+private:
+    std::size_t _size;
+};
+
+/**
+ * Buffering policy which adjusts buffer size to the traffic.
+ *
+ * The buffer is doubled (up to <code>max_size</code>) after
+ * <code>grow_after</code> consecutive flushes of a (nearly) full buffer and
+ * halved (down to <code>min_size</code>) after <code>shrink_after</code>
+ * consecutive flushes which used less than a quarter of it.
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<nova::file_sink, nova::adaptive_buffering> out{nova::adaptive_buffering{4096, 1 << 20}, "data.log"};
+ * ~~~~~
+ *
+ * @see buffering
+ */
+class adaptive_buffering
+{
+public:
+    /**
+     * Number of consecutive full flushes after which the buffer grows.
+     */
+    static constexpr unsigned grow_after = 2;
+    /**
+     * Number of consecutive small flushes after which the buffer shrinks.
+     */
+    static constexpr unsigned shrink_after = 8;
+
+    /**
+     * @param initial_size initial buffer size
+     * @param max_size maximum buffer size
+     * @param min_size minimum buffer size
+     */
+    explicit adaptive_buffering(std::size_t initial_size = 4096, std::size_t max_size = 1 << 20,
+                                std::size_t min_size = 256) :
+            _min{min_size > 0 ? min_size : 1}, _max{max_size > _min ? max_size : _min},
+            _size{initial_size < _min ? _min : initial_size > _max ? _max : initial_size} {}
+
+    /**
+     * @return current buffer size.
+     */
+    std::size_t size() const { return _size; }
+
+    /**
+     * @param used number of characters which went through the buffer.
+     * @return buffer size to use from now on.
+     */
+    std::size_t next_size(std::size_t used)
+    {
+        if (used >= _size - _size / 8)
+        {
+            _small = 0;
+            if (++_full >= grow_after && _size < _max)
+            {
+                _size = _size > _max / 2 ? _max : _size * 2;
+                _full = 0;
+            }
+        }
+        else if (used < _size / 4)
+        {
+            _full = 0;
+            if (++_small >= shrink_after && _size > _min)
+            {
+                _size = _size / 2 < _min ? _min : _size / 2;
+                _small = 0;
+            }
+        }
+        else _full = _small = 0;
+        return _size;
+    }
+private:
+    std::size_t _min;
+    std::size_t _max;
+    std::size_t _size;
+    unsigned _full = 0;
+    unsigned _small = 0;
 };
 
 /**
@@ -114,6 +253,17 @@ typedef buffering<8192> buffer_8k;
  *
  * Method <code>flush</code> will flush the underlying stream or do nothing
  * if the stream cannot be flushed.
+ *
+ * Optionally the sink may have the method
+ *
+ * ~~~~~{.cpp}
+ * std::streamsize write_v(const std::pair<const CharT*, std::size_t>* spans, int count);
+ * ~~~~~
+ *
+ * which writes <code>count</code> spans in order as one gathered write
+ * (like <code>writev</code>) and returns the total number of characters
+ * written. Buffered streams use it to write their pending buffer together
+ * with a large block passed to <code>write</code>, which is not copied.
  */
 struct sink {};
 /**
@@ -131,7 +281,7 @@ struct sink {};
  * and the following method:
  *
  * ~~~~~{.cpp}
- * std::streamsize read(const CharT* s, std::streamsize n);
+ * std::streamsize read(CharT* s, std::streamsize n);
  * ~~~~~
  *
  * Method <code>read</code> reads from the underlying stream into buffer
@@ -171,6 +321,19 @@ struct source {};
  * or closed. As the argument it receives the number of characters written
  * to the stream since last call to <code>get_out_buffer</code> or
  * <code>flush</code>.
+ *
+ * Optionally the provider may have the method
+ *
+ * ~~~~~{.cpp}
+ * void release_out_buffer(CharT* buf, std::size_t written);
+ * ~~~~~
+ *
+ * which is called when the stream is done with the buffer
+ * <code>buf</code> returned by <code>get_out_buffer</code>: before the
+ * next buffer is requested, on seek, <code>rebind</code> and destruction.
+ * <code>written</code> is the number of characters written into it, the
+ * rest of the buffer was not used. After this call the provider may reuse
+ * the buffer.
  */
 struct out_buffer_provider {};
 /**
@@ -199,16 +362,191 @@ struct out_buffer_provider {};
  * Note that in C++17 this method can also return
  * <code>std::tuple<const char_type*, std::size_t></code> or
  * <code>struct {const char_type*, std::size_t}</code>.
+ *
+ * Optionally the provider may have the method
+ *
+ * ~~~~~{.cpp}
+ * void release_in_buffer(const CharT* buf, std::size_t consumed);
+ * ~~~~~
+ *
+ * which is called when the stream is done with the buffer
+ * <code>buf</code> returned by <code>get_in_buffer</code>: before the next
+ * buffer is requested, on seek, <code>rebind</code> and destruction.
+ * <code>consumed</code> is the number of characters read from it, the rest
+ * was not read. After this call the provider may reuse or free the buffer.
  */
 struct in_buffer_provider {};
+/**
+ * Seekable concept.
+ *
+ * Any <code>Source</code> or <code>Sink</code> (of either category) may
+ * additionally have the method
+ *
+ * ~~~~~{.cpp}
+ * std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir);
+ * ~~~~~
+ *
+ * which moves its read (or write) position to <code>off</code> characters
+ * relative to <code>dir</code> and returns the new absolute position or -1
+ * on failure. For nova::in_buffer_provider and nova::out_buffer_provider the
+ * next buffer requested after <code>seek</code> must start at the new
+ * position.
+ *
+ * Streams over seekable objects support <code>seekg</code>,
+ * <code>seekp</code> and the rest of <code>std::basic_streambuf</code>
+ * positioning. Seeks which stay within the current input buffer only move
+ * the stream pointers and never reach the <code>Source</code>.
+ * <code>tellg</code> and <code>tellp</code> work on every stream.
+ *
+ * Devices shared between nova::device_instream and nova::device_outstream
+ * provide <code>seek(off, dir, which)</code> instead, with
+ * <code>which</code> being <code>std::ios_base::in</code> or
+ * <code>std::ios_base::out</code>.
+ */
+template<typename T>
+auto _is_seekable(int) -> decltype(std::declval<T&>().seek(std::streamoff{}, std::ios_base::beg), std::true_type{});
+template<typename T>
+std::false_type _is_seekable(...);
+
+template<typename T>
+struct is_seekable : decltype(_is_seekable<T>(0)) {};
+
+template<typename T>
+auto _releases_in_buffer(int) -> decltype(std::declval<T&>().release_in_buffer(
+        std::declval<const typename T::char_type*>(), std::size_t{}), std::true_type{});
+template<typename T>
+std::false_type _releases_in_buffer(...);
+
+/**
+ * Detects nova::in_buffer_provider with optional
+ * <code>release_in_buffer</code> method.
+ */
+template<typename T>
+struct releases_in_buffer : decltype(_releases_in_buffer<T>(0)) {};
+
+template<typename T>
+auto _releases_out_buffer(int) -> decltype(std::declval<T&>().release_out_buffer(
+        std::declval<typename T::char_type*>(), std::size_t{}), std::true_type{});
+template<typename T>
+std::false_type _releases_out_buffer(...);
+
+/**
+ * Detects nova::out_buffer_provider with optional
+ * <code>release_out_buffer</code> method.
+ */
+template<typename T>
+struct releases_out_buffer : decltype(_releases_out_buffer<T>(0)) {};
+
+template<typename T>
+auto _writes_vectored(int) -> decltype(std::declval<T&>().write_v(
+        std::declval<const std::pair<const typename T::char_type*, std::size_t>*>(), int{}), std::true_type{});
+template<typename T>
+std::false_type _writes_vectored(...);
 
-template<typename Sink, typename Buffering, typename Traits, typename Category = void>
+/**
+ * Detects nova::sink with optional <code>write_v</code> method.
+ */
+template<typename T>
+struct writes_vectored : decltype(_writes_vectored<T>(0)) {};
+
+/**
+ * Characters reserved in an output stream by <code>outstream::reserve</code>
+ * to be filled in later by <code>outstream::backpatch</code>.
+ */
+struct out_reservation
+{
+    /**
+     * Stream position of the first reserved character, negative if nothing
+     * was reserved.
+     */
+    std::streamoff pos = -1;
+    /**
+     * Number of reserved characters.
+     */
+    std::size_t size = 0;
+
+    /**
+     * @return stream position right after the reserved characters.
+     */
+    std::streamoff end() const { return pos + static_cast<std::streamoff>(size); }
+
+    explicit operator bool() const { return pos >= 0; }
+};
+
+/* Replaces the object with the one constructed from args, used by rebind.
+ * The new object is constructed in place only if that cannot throw,
+ * otherwise it is constructed aside and moved in, so a throwing
+ * constructor leaves the old object in place. */
+template<typename T, typename... Args>
+void _recreate_in_place(T& obj, Args&&... args) noexcept
+{
+    obj.~T();
+    ::new (static_cast<void*>(std::addressof(obj))) T{std::forward<Args>(args)...};
+}
+template<typename T, typename... Args>
+void _recreate(std::true_type, T& obj, Args&&... args)
+{
+    _recreate_in_place(obj, std::forward<Args>(args)...);
+}
+template<typename T>
+void _move_into(T& obj, T& tmp, std::true_type) { _recreate_in_place(obj, std::move(tmp)); }
+template<typename T>
+void _move_into(T& obj, T& tmp, std::false_type)
+{
+    static_assert(std::is_move_assignable<T>::value, "rebind needs a Sink or Source which is nothrow "
+                  "constructible from the arguments, nothrow move constructible or move assignable");
+    obj = std::move(tmp);
+}
+template<typename T, typename... Args>
+void _recreate(std::false_type, T& obj, Args&&... args)
+{
+    T tmp{std::forward<Args>(args)...};
+    _move_into(obj, tmp, std::is_nothrow_move_constructible<T>{});
+}
+template<typename T, typename... Args>
+void _recreate(T& obj, Args&&... args)
+{
+    _recreate(std::integral_constant<bool, std::is_nothrow_constructible<T, Args&&...>::value>{},
+              obj, std::forward<Args>(args)...);
+}
+
+/* Replaces the streambuf of an inline stream with the one moved from
+ * other. If moving can throw, other's is first moved aside: a throw there
+ * leaves obj alone (other may be moved-from), a throw from the second move,
+ * with obj already destroyed, terminates. */
+template<typename T>
+void _move_streambuf(T& obj, T& other, std::true_type) noexcept { _recreate_in_place(obj, std::move(other)); }
+template<typename T>
+void _move_streambuf(T& obj, T& other, std::false_type)
+{
+    T tmp{std::move(other)};
+    _recreate_in_place(obj, std::move(tmp));
+}
+
+/* Restores the state and the formatting of a newly constructed stream,
+ * keeping its locale. */
+template<typename CharT, typename Traits>
+void _reset_ios(std::basic_ios<CharT, Traits>& ios)
+{
+    ios.exceptions(std::ios_base::goodbit);
+    ios.tie(nullptr);
+    ios.clear();
+    ios.flags(std::ios_base::skipws | std::ios_base::dec);
+    ios.precision(6);
+    ios.width(0);
+    ios.fill(ios.widen(' '));
+}
+
+template<typename Sink, typename Buffering, typename Traits,
+         typename Allocator = std::allocator<typename Sink::char_type>, typename Category = void>
 class basic_outbuf;
 
-template<typename Sink, typename Buffering, typename Traits, typename Category>
+template<typename Sink, typename Buffering, typename Traits, typename Allocator, typename Category>
 class basic_outbuf : public std::basic_streambuf<typename Sink::char_type, Traits>
 {
     typedef std::basic_streambuf<typename Sink::char_type, Traits> _buf_type;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<typename Sink::char_type> _alloc_type;
+    typedef std::allocator_traits<_alloc_type> _alloc_traits;
 public:
     typedef typename Sink::char_type  char_type;
     typedef Traits                    traits_type;
@@ -220,15 +558,36 @@ public:
 
     template<class... Args>
     explicit basic_outbuf(Args &&... args) :
-            _sink{std::forward<Args>(args)...}, _buffer{new char_type[Buffering::buf_size]}
+            _sink{std::forward<Args>(args)...}, _buffering{}, _alloc{}, _capacity{_buffering.size()},
+            _buffer{_alloc_traits::allocate(_alloc, _capacity)}
     {
-        _buf_type::setp(_buffer, _buffer + Buffering::buf_size - 1);
+        reset();
+    }
+
+    template<class... Args>
+    explicit basic_outbuf(Buffering buffering, Args &&... args) :
+            _sink{std::forward<Args>(args)...}, _buffering{buffering}, _alloc{}, _capacity{_buffering.size()},
+            _buffer{_alloc_traits::allocate(_alloc, _capacity)}
+    {
+        reset();
     }
 
     basic_outbuf(const basic_outbuf& other) = delete;
-    basic_outbuf(basic_outbuf&& ) = delete;
+    basic_outbuf(basic_outbuf&& other)
+            noexcept(std::is_nothrow_move_constructible<Sink>::value && std::is_nothrow_copy_constructible<Buffering>::value) :
+            _buf_type{other}, _sink{std::move(other._sink)}, _buffering{other._buffering}, _alloc{other._alloc},
+            _capacity{std::exchange(other._capacity, 0)}, _buffer{std::exchange(other._buffer, nullptr)}, _pos{other._pos},
+            _open{std::move(other._open)}
+    {
+        other.setp(nullptr, nullptr);
+    }
 
-    ~basic_outbuf() noexcept override = default;
+    ~basic_outbuf() noexcept override
+    {
+        std::streamsize size = _buf_type::pptr() - _buf_type::pbase();
+        if (size > 0) _sink.write(_buffer, size);
+        if (_buffer) _alloc_traits::deallocate(_alloc, _buffer, _capacity);
+    }
 
     basic_outbuf& operator=(const basic_outbuf& ) = delete;
     basic_outbuf& operator=(basic_outbuf&& ) = delete;
@@ -239,35 +598,284 @@ public:
     const Sink& operator*() const { return _sink; }
     const Sink* operator->() const { return &_sink; }
 
-    void reset() { _buf_type::setp(_buffer, _buffer + Buffering::buf_size - 1); }
+    /**
+     * Accounts for <code>n</code> characters written to the sink outside of
+     * the stream buffer (see nova::copy). Must be called with no pending
+     * characters in the buffer.
+     */
+    void transferred(std::streamsize n) { _pos += n; }
+
+    void reset() { _buf_type::setp(_buffer, _buffer + _buffering.size() - 1); }
+
+    /**
+     * Writes the pending characters to the current sink, replaces it with
+     * the one constructed from <code>args</code> and keeps the buffer.
+     */
+    template<class... Args>
+    void rebind(Args&&... args)
+    {
+        std::streamsize size = _buf_type::pptr() - _buf_type::pbase();
+        if (!_buffer)
+        {
+            _capacity = _buffering.size();
+            _buffer = _alloc_traits::allocate(_alloc, _capacity);
+        }
+        _pos = 0;
+        _open.clear();
+        reset();
+        if (size > 0) _sink.write(_buffer, size);
+        _recreate(_sink, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Provides direct access to the free part of the stream buffer, writing
+     * the buffer to the sink first if it is full. Characters written to the
+     * returned span become part of the stream after the call to
+     * <code>commit</code>.
+     *
+     * @return pointer to the writable span and its size or <code>{nullptr, 0}</code>
+     *         if the buffer could not be written to the sink.
+     */
+    std::pair<char_type*, std::size_t> out_span()
+    {
+        if (_buf_type::pptr() == _buf_type::epptr() && !(_open.empty() ? write_pending() : hold_room(1))) return {nullptr, 0};
+        return {_buf_type::pptr(), static_cast<std::size_t>(_buf_type::epptr() - _buf_type::pptr())};
+    }
+
+    /**
+     * Marks <code>n</code> characters of the span returned by
+     * <code>out_span</code> as written.
+     *
+     * @param n number of characters written, must not exceed the span size.
+     */
+    void commit(std::size_t n) { _buf_type::pbump(static_cast<int>(n)); }
+
+    /**
+     * Reserves <code>n</code> characters (set to zero) at the current
+     * position, to be filled in by <code>backpatch</code>. The buffer is
+     * held back from the oldest reservation not filled in yet: writing the
+     * buffer only writes what precedes it, and the buffer grows when the
+     * held part leaves no room.
+     *
+     * @return the reservation, empty if the buffer could not be written to the sink.
+     */
+    out_reservation reserve(std::size_t n)
+    {
+        if (static_cast<std::size_t>(_buf_type::epptr() - _buf_type::pptr()) < n && !hold_room(n)) return {};
+        off_type pos = _pos + (_buf_type::pptr() - _buf_type::pbase());
+        _open.push_back(pos);
+        traits_type::assign(_buf_type::pptr(), n, char_type());
+        _buf_type::pbump(static_cast<int>(n));
+        return {pos, n};
+    }
+
+    /**
+     * Fills in the characters reserved by <code>reserve</code> from
+     * <code>s</code>. Filling in a reservation again does nothing.
+     *
+     * @return <code>false</code> if the reservation is no longer in the buffer.
+     */
+    bool backpatch(const out_reservation& slot, const char_type* s)
+    {
+        if (!slot || slot.pos < _pos || slot.end() > _pos + (_buf_type::pptr() - _buf_type::pbase())) return false;
+        if (!close_reservation(slot.pos)) return true;
+        traits_type::copy(_buffer + (slot.pos - _pos), s, slot.size);
+        return true;
+    }
 
 protected:
     int_type overflow(int_type ch) override
     {
-        _buffer[Buffering::buf_size-1] = static_cast<char>(ch);
-        _buf_type::setp(_buffer, _buffer + Buffering::buf_size - 1);
-        return _sink.write(_buffer, Buffering::buf_size) < Buffering::buf_size ? traits_type::eof() : ch;
+        if (!_open.empty())
+        {
+            if (!hold_room(1)) return traits_type::eof();
+            *_buf_type::pptr() = traits_type::to_char_type(ch);
+            _buf_type::pbump(1);
+            return ch;
+        }
+        /* The buffer has room for one more character past epptr(). */
+        std::size_t size = static_cast<std::size_t>(_buf_type::epptr() - _buf_type::pbase()) + 1;
+        _buffer[size-1] = static_cast<char>(ch);
+        std::streamsize res = _sink.write(_buffer, size);
+        if (res > 0) _pos += res;
+        drained(size);
+        return res >= static_cast<std::streamsize>(size) ? ch : traits_type::eof();
     }
 
     int sync() override
     {
-        std::size_t size = _buf_type::pptr() - _buf_type::pbase();
-        if (size > 0)
-        {
-            if (_sink.write(_buffer, static_cast<std::streamsize>(size)) < size) return -1;
-        }
+        if (!(_open.empty() ? write_pending() : hold_room(0))) return -1;
         _sink.flush();
-        _buf_type::setp(_buffer, _buffer + Buffering::buf_size - 1);
         return 0;
     }
 
+    std::streamsize xsputn(const char_type* s, std::streamsize n) override
+    {
+        std::streamsize avail = _buf_type::epptr() - _buf_type::pptr();
+        if (n <= avail)
+        {
+            traits_type::copy(_buf_type::pptr(), s, static_cast<std::size_t>(n));
+            _buf_type::pbump(static_cast<int>(n));
+            return n;
+        }
+        if (!_open.empty())
+        {
+            if (!hold_room(static_cast<std::size_t>(n))) return 0;
+            traits_type::copy(_buf_type::pptr(), s, static_cast<std::size_t>(n));
+            _buf_type::pbump(static_cast<int>(n));
+            return n;
+        }
+        /* Blocks which would not fit into an empty buffer anyway are not copied at all:
+         * whatever is pending is written first to keep the order and then the caller's
+         * memory goes directly to the sink. */
+        if (n >= static_cast<std::streamsize>(_buffering.size())) return write_direct(s, n, writes_vectored<Sink>{});
+        traits_type::copy(_buf_type::pptr(), s, static_cast<std::size_t>(avail));
+        _buf_type::pbump(static_cast<int>(avail));
+        if (!write_pending()) return avail;
+        traits_type::copy(_buf_type::pptr(), s + avail, static_cast<std::size_t>(n - avail));
+        _buf_type::pbump(static_cast<int>(n - avail));
+        return n;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::out)) return pos_type(off_type(-1));
+        off_type cur = _pos + (_buf_type::pptr() - _buf_type::pbase());
+        if (dir == std::ios_base::cur && off == 0) return pos_type(cur);
+        return seek_to(off, dir, cur, is_seekable<Sink>{});
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
 private:
+    pos_type seek_to(off_type off, std::ios_base::seekdir dir, off_type cur, std::true_type)
+    {
+        if (!_open.empty() || !write_pending()) return pos_type(off_type(-1));
+        if (dir == std::ios_base::cur) off += cur;
+        if (dir != std::ios_base::end && off < 0) return pos_type(off_type(-1));
+        std::streamoff res = _sink.seek(off, dir == std::ios_base::end ? dir : std::ios_base::beg);
+        if (res < 0) return pos_type(off_type(-1));
+        _pos = res;
+        return pos_type(res);
+    }
+    pos_type seek_to(off_type, std::ios_base::seekdir, off_type, std::false_type) { return pos_type(off_type(-1)); }
+
+    bool write_pending()
+    {
+        std::streamsize size = _buf_type::pptr() - _buf_type::pbase();
+        if (size <= 0) return true;
+        std::streamsize res = _sink.write(_buffer, size);
+        drop_written(size, res);
+        return res >= size;
+    }
+
+    std::streamsize write_direct(const char_type* s, std::streamsize n, std::false_type)
+    {
+        if (!write_pending()) return 0;
+        std::streamsize res = _sink.write(s, n);
+        if (res > 0) _pos += res;
+        return res;
+    }
+    /* The pending characters and the block go out in one gathered write. */
+    std::streamsize write_direct(const char_type* s, std::streamsize n, std::true_type)
+    {
+        std::streamsize size = _buf_type::pptr() - _buf_type::pbase();
+        if (size <= 0) return write_direct(s, n, std::false_type{});
+        std::pair<const char_type*, std::size_t> spans[2] = {{_buffer, static_cast<std::size_t>(size)},
+                                                             {s, static_cast<std::size_t>(n)}};
+        std::streamsize res = _sink.write_v(spans, 2);
+        drop_written(size, res);
+        return res < size ? 0 : res - size;
+    }
+
+    /* Accounts for res characters written of the size pending ones; those
+     * which did not go out stay in the buffer. */
+    void drop_written(std::streamsize size, std::streamsize res)
+    {
+        if (res > 0) _pos += res;
+        if (res >= size) return drained(static_cast<std::size_t>(size));
+        if (res <= 0) return;
+        traits_type::move(_buffer, _buffer + res, static_cast<std::size_t>(size - res));
+        _buf_type::setp(_buffer, _buffer + _capacity - 1);
+        _buf_type::pbump(static_cast<int>(size - res));
+    }
+
+    /* Removes the reservation at pos from the open ones, returns false if
+     * it was filled in already. */
+    bool close_reservation(off_type pos)
+    {
+        for (auto it = _open.begin(); it != _open.end(); ++it)
+        {
+            if (*it != pos) continue;
+            _open.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    /* Makes room for n characters: writes what precedes the oldest open
+     * reservation, moves the rest to the front of the buffer and grows the
+     * buffer if that is not enough. */
+    bool hold_room(std::size_t n)
+    {
+        std::size_t used = static_cast<std::size_t>(_buf_type::pptr() - _buf_type::pbase());
+        std::size_t ready = _open.empty() ? used : static_cast<std::size_t>(_open.front() - _pos);
+        if (ready > 0)
+        {
+            std::streamsize res = _sink.write(_buffer, static_cast<std::streamsize>(ready));
+            if (res > 0) _pos += res;
+            if (res < static_cast<std::streamsize>(ready))
+            {
+                _open.clear();
+                drained(used);
+                return false;
+            }
+            used -= ready;
+            traits_type::move(_buffer, _buffer + ready, used);
+        }
+        if (used + n >= _capacity)
+        {
+            std::size_t capacity = used + n < _capacity * 2 ? _capacity * 2 : used + n + 1;
+            char_type* buffer = _alloc_traits::allocate(_alloc, capacity);
+            traits_type::copy(buffer, _buffer, used);
+            _alloc_traits::deallocate(_alloc, _buffer, _capacity);
+            _capacity = capacity;
+            _buffer = buffer;
+        }
+        _buf_type::setp(_buffer, _buffer + _capacity - 1);
+        _buf_type::pbump(static_cast<int>(used));
+        return true;
+    }
+
+    /* Called whenever the buffer content went to the sink: lets the buffering
+     * policy resize the buffer while it is empty. */
+    void drained(std::size_t used)
+    {
+        if (_buffering.next_size(used) != _capacity)
+        {
+            if (_buffer) _alloc_traits::deallocate(_alloc, _buffer, _capacity);
+            _capacity = _buffering.size();
+            _buffer = _alloc_traits::allocate(_alloc, _capacity);
+        }
+        reset();
+    }
+
     Sink _sink;
+    Buffering _buffering;
+    _alloc_type _alloc;
+    std::size_t _capacity;
     char_type *_buffer;
+    /* Sink position of the beginning of the buffer. */
+    off_type _pos = 0;
+    /* Positions of the reservations not filled in yet, oldest first. */
+    std::vector<off_type, typename std::allocator_traits<Allocator>::template rebind_alloc<off_type>> _open;
 };
 
-template<typename Sink, typename Traits>
-class basic_outbuf<Sink, non_buffered, Traits,
+template<typename Sink, typename Traits, typename Allocator>
+class basic_outbuf<Sink, non_buffered, Traits, Allocator,
                    typename std::enable_if_t<std::is_same<typename Sink::category, out_buffer_provider>::value>> :
         public std::basic_streambuf<typename Sink::char_type, Traits>
 {
@@ -283,9 +891,24 @@ public:
     explicit basic_outbuf(Args &&... args) : _sink{std::forward<Args>(args)...} { }
 
     basic_outbuf(const basic_outbuf& other) = delete;
-    basic_outbuf(basic_outbuf&& ) = delete;
+    /**
+     * Takes over the sink and the free part of its current buffer, which
+     * must not live inside the sink object.
+     */
+    basic_outbuf(basic_outbuf&& other) noexcept(std::is_nothrow_move_constructible<Sink>::value) :
+            _buf_type{other}, _sink{std::move(other._sink)}, _span{other._span}, _pos{other._pos},
+            _open{std::move(other._open)}
+    {
+        other.setp(nullptr, nullptr);
+        other._span = nullptr;
+    }
 
-    ~basic_outbuf() noexcept override { sync(); }
+    ~basic_outbuf() noexcept override
+    {
+        _open.clear();
+        sync();
+        release_span(releases_out_buffer<Sink>{});
+    }
 
     basic_outbuf& operator=(const basic_outbuf& ) = delete;
     basic_outbuf& operator=(basic_outbuf&& ) = delete;
@@ -296,41 +919,217 @@ public:
     const Sink& operator*() const { return _sink; }
     const Sink* operator->() const { return &_sink; }
 
+    /**
+     * Accounts for <code>n</code> characters written to the sink outside of
+     * the stream buffer (see nova::copy). Must be called with no pending
+     * characters in the buffer.
+     */
+    void transferred(std::streamsize n) { _pos += n; }
+
     void reset() { _buf_type::setp(_buf_type::pbase(), _buf_type::epptr()); }
 
+    /**
+     * Flushes the current provider and replaces it with the one
+     * constructed from <code>args</code>.
+     */
+    template<class... Args>
+    void rebind(Args&&... args)
+    {
+        _open.clear();
+        sync();
+        release_span(releases_out_buffer<Sink>{});
+        _pos = 0;
+        _buf_type::setp(nullptr, nullptr);
+        _recreate(_sink, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Provides direct access to the free part of the current provider's
+     * buffer, requesting the next buffer from the provider if the current
+     * one is exhausted. Characters written to the returned span become part
+     * of the stream after the call to <code>commit</code>.
+     *
+     * @return pointer to the writable span and its size or <code>{nullptr, 0}</code>
+     *         if the provider has no more space.
+     */
+    std::pair<char_type*, std::size_t> out_span()
+    {
+        if (_buf_type::pptr() == _buf_type::epptr() && !next_buffer()) return {nullptr, 0};
+        return {_buf_type::pptr(), static_cast<std::size_t>(_buf_type::epptr() - _buf_type::pptr())};
+    }
+
+    /**
+     * Marks <code>n</code> characters of the span returned by
+     * <code>out_span</code> as written.
+     *
+     * @param n number of characters written, must not exceed the span size.
+     */
+    void commit(std::size_t n) { advance(n); }
+
+    /**
+     * Reserves <code>n</code> characters (set to zero) at the current
+     * position, to be filled in by <code>backpatch</code>. The reserved
+     * characters must fit into the rest of the current buffer of the
+     * provider. Flushing only hands the characters preceding the oldest
+     * reservation not filled in yet to the provider. A
+     * reservation is lost when the buffer fills up and the next one is
+     * requested, then <code>backpatch</code> fails.
+     *
+     * @return the reservation, empty if the current buffer has no room for it.
+     */
+    out_reservation reserve(std::size_t n)
+    {
+        if (_buf_type::pptr() == _buf_type::epptr() && !next_buffer()) return {};
+        if (static_cast<std::size_t>(_buf_type::epptr() - _buf_type::pptr()) < n) return {};
+        off_type pos = _pos + (_buf_type::pptr() - _buf_type::pbase());
+        _open.push_back(pos);
+        traits_type::assign(_buf_type::pptr(), n, char_type());
+        advance(n);
+        return {pos, n};
+    }
+
+    /**
+     * Fills in the characters reserved by <code>reserve</code> from
+     * <code>s</code>. Filling in a reservation again does nothing.
+     *
+     * @return <code>false</code> if the reservation was already handed to the provider.
+     */
+    bool backpatch(const out_reservation& slot, const char_type* s)
+    {
+        if (!slot || slot.pos < _pos || slot.end() > _pos + (_buf_type::pptr() - _buf_type::pbase())) return false;
+        if (!close_reservation(slot.pos)) return true;
+        traits_type::copy(_buf_type::pbase() + (slot.pos - _pos), s, slot.size);
+        return true;
+    }
+
 protected:
     int_type overflow(int_type ch) override
     {
+        if (!next_buffer()) return traits_type::eof();
+        *_buf_type::pptr() = traits_type::to_char_type(ch);
+        _buf_type::pbump(1);
+        return ch;
+    }
+
+    int sync() override
+    {
+        char_type* ptr = _buf_type::pptr();
+        /* Open reservations and what follows them stay in the stream. */
+        char_type* end = _open.empty() ? ptr : _buf_type::pbase() + (_open.front() - _pos);
+        _sink.flush(end - _buf_type::pbase());
+        _pos += end - _buf_type::pbase();
+        _buf_type::setp(end, _buf_type::epptr());
+        advance(static_cast<std::size_t>(ptr - end));
+        return 0;
+    }
+
+    std::streamsize xsputn(const char_type* s, std::streamsize n) override
+    {
+        std::streamsize done = 0;
+        while (done < n)
+        {
+            if (_buf_type::pptr() == _buf_type::epptr() && !next_buffer()) break;
+            std::streamsize avail = _buf_type::epptr() - _buf_type::pptr();
+            std::streamsize chunk = avail < n - done ? avail : n - done;
+            traits_type::copy(_buf_type::pptr(), s + done, static_cast<std::size_t>(chunk));
+            advance(static_cast<std::size_t>(chunk));
+            done += chunk;
+        }
+        return done;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::out)) return pos_type(off_type(-1));
+        off_type cur = _pos + (_buf_type::pptr() - _buf_type::pbase());
+        if (dir == std::ios_base::cur && off == 0) return pos_type(cur);
+        return seek_to(off, dir, cur, is_seekable<Sink>{});
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+private:
+    pos_type seek_to(off_type off, std::ios_base::seekdir dir, off_type cur, std::true_type)
+    {
+        if (!_open.empty()) return pos_type(off_type(-1));
+        sync();
+        if (dir == std::ios_base::cur) off += cur;
+        if (dir != std::ios_base::end && off < 0) return pos_type(off_type(-1));
+        release_span(releases_out_buffer<Sink>{});
+        std::streamoff res = _sink.seek(off, dir == std::ios_base::end ? dir : std::ios_base::beg);
+        if (res < 0) return pos_type(off_type(-1));
+        _pos = res;
+        _buf_type::setp(nullptr, nullptr);
+        return pos_type(res);
+    }
+    pos_type seek_to(off_type, std::ios_base::seekdir, off_type, std::false_type) { return pos_type(off_type(-1)); }
+
+    /* Removes the reservation at pos from the open ones, returns false if
+     * it was filled in already. */
+    bool close_reservation(off_type pos)
+    {
+        for (auto it = _open.begin(); it != _open.end(); ++it)
+        {
+            if (*it != pos) continue;
+            _open.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    bool next_buffer()
+    {
+        /* The full span goes to the provider with the open reservations. */
+        _open.clear();
+        _pos += _buf_type::pptr() - _buf_type::pbase();
+        _buf_type::setp(_buf_type::pptr(), _buf_type::epptr());
+        release_span(releases_out_buffer<Sink>{});
 #if __cplusplus > 201700L
         auto [buf, size] = _sink.get_out_buffer();
-        if (!buf || size <= 0) return traits_type::eof();
-        *buf = ch;
+        if (!buf || size <= 0) return false;
         _buf_type::setp(buf, buf + size);
-        _buf_type::pbump(1);
-        return ch;
+        _span = buf;
 #else
         auto res = _sink.get_out_buffer();
-        if (!res.first || res.second <= 0) return traits_type::eof();
-        *res.first = ch;
-        _buf_type::setp(res.first + 1, res.first + res.second);
-        _buf_type::pbump(1);
-        return ch;
+        if (!res.first || res.second <= 0) return false;
+        _buf_type::setp(res.first, res.first + res.second);
+        _span = res.first;
 #endif
+        return true;
     }
 
-    int sync() override
+    /* Tells the provider the stream is done with the current span and
+     * drops it. */
+    void release_span(std::true_type)
     {
-        _sink.flush(_buf_type::pptr() - _buf_type::pbase());
-        _buf_type::setp(_buf_type::pptr(), _buf_type::epptr());
-        return 0;
+        if (!_span) return;
+        _sink.release_out_buffer(_span, static_cast<std::size_t>(_buf_type::pptr() - _span));
+        _span = nullptr;
+        _buf_type::setp(nullptr, nullptr);
+    }
+    void release_span(std::false_type) { _span = nullptr; }
+
+    void advance(std::size_t n)
+    {
+        /* pbump only takes int, provider buffers can be larger than that. */
+        for (; n > INT_MAX; n -= INT_MAX) _buf_type::pbump(INT_MAX);
+        _buf_type::pbump(static_cast<int>(n));
     }
 
-private:
     Sink _sink;
+    /* Beginning of the span from get_out_buffer, pbase() moves on sync. */
+    char_type* _span = nullptr;
+    /* Sink position of pbase(). */
+    off_type _pos = 0;
+    /* Positions of the reservations not filled in yet, oldest first. */
+    std::vector<off_type, typename std::allocator_traits<Allocator>::template rebind_alloc<off_type>> _open;
 };
 
-template<typename Sink, typename Traits, typename Category>
-class basic_outbuf<Sink, non_buffered, Traits, Category> : public std::basic_streambuf<typename Sink::char_type, Traits>
+template<typename Sink, typename Traits, typename Allocator, typename Category>
+class basic_outbuf<Sink, non_buffered, Traits, Allocator, Category> : public std::basic_streambuf<typename Sink::char_type, Traits>
 {
     typedef std::basic_streambuf<typename Sink::char_type, Traits> _buf_type;
 public:
@@ -345,32 +1144,96 @@ public:
     ~basic_outbuf() noexcept override = default;
 
     basic_outbuf(const basic_outbuf& ) = default;
-    basic_outbuf(basic_outbuf&& ) noexcept = default;
+    basic_outbuf(basic_outbuf&& ) noexcept(std::is_nothrow_move_constructible<Sink>::value) = default;
 
     basic_outbuf& operator=(const basic_outbuf& ) = default;
-    basic_outbuf& operator=(basic_outbuf&& ) noexcept = default;
+    basic_outbuf& operator=(basic_outbuf&& ) noexcept(std::is_nothrow_move_assignable<Sink>::value) = default;
 
     void reset() { }
 
+    /**
+     * Replaces the sink with the one constructed from <code>args</code>.
+     */
+    template <class... Args>
+    void rebind(Args&&... args)
+    {
+        _pos = 0;
+        _recreate(_sink, std::forward<Args>(args)...);
+    }
+
     Sink& operator*() { return _sink; }
     Sink* operator->() { return &_sink; }
 
     const Sink& operator*() const { return _sink; }
     const Sink* operator->() const { return &_sink; }
 
+    /**
+     * Accounts for <code>n</code> characters written to the sink outside of
+     * the stream buffer (see nova::copy). Must be called with no pending
+     * characters in the buffer.
+     */
+    void transferred(std::streamsize n) { _pos += n; }
+
+    /**
+     * Not buffered stream has no space to write to directly.
+     *
+     * @return always <code>{nullptr, 0}</code>.
+     */
+    std::pair<char_type*, std::size_t> out_span() { return {nullptr, 0}; }
+    void commit(std::size_t ) { }
+
+    /**
+     * Not buffered stream has nothing to hold the reserved characters in.
+     *
+     * @return always an empty reservation.
+     */
+    out_reservation reserve(std::size_t ) { return {}; }
+    bool backpatch(const out_reservation& , const char_type* ) { return false; }
+
 protected:
     int_type overflow(int_type ch) override
     {
         auto tmp_ch = static_cast<char_type>(ch);
-        return _sink.write(&tmp_ch, 1) == 1 ? ch : traits_type::eof();
+        if (_sink.write(&tmp_ch, 1) != 1) return traits_type::eof();
+        ++_pos;
+        return ch;
     }
 
     int sync() override { _sink.flush(); return 0; }
 
-    std::streamsize xsputn(const char_type* s, std::streamsize n) override { return _sink.write(s, n); }
+    std::streamsize xsputn(const char_type* s, std::streamsize n) override
+    {
+        std::streamsize res = _sink.write(s, n);
+        if (res > 0) _pos += res;
+        return res;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::out)) return pos_type(off_type(-1));
+        if (dir == std::ios_base::cur && off == 0) return pos_type(_pos);
+        return seek_to(off, dir, _pos, is_seekable<Sink>{});
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
 
 private:
+    pos_type seek_to(off_type off, std::ios_base::seekdir dir, off_type cur, std::true_type)
+    {
+        if (dir == std::ios_base::cur) off += cur;
+        if (dir != std::ios_base::end && off < 0) return pos_type(off_type(-1));
+        std::streamoff res = _sink.seek(off, dir == std::ios_base::end ? dir : std::ios_base::beg);
+        if (res < 0) return pos_type(off_type(-1));
+        _pos = res;
+        return pos_type(res);
+    }
+    pos_type seek_to(off_type, std::ios_base::seekdir, off_type, std::false_type) { return pos_type(off_type(-1)); }
+
     Sink _sink;
+    off_type _pos = 0;
 };
 
 
@@ -385,19 +1248,25 @@ private:
  * specifications of either nova::sink or nova::out_buffer_provider.
  *
  * @tparam Sink sink object to use to write data.
- * @tparam Buffering Buffer size to be used. It must be nova::non_buffered
+ * @tparam Buffering Buffer size or buffering policy to be used (see
+ *                   nova::buffering). It must be nova::non_buffered
  *                   if nova::out_buffer_provider is used as
  *                   <code>Sink</code>
  * @tparam Traits character traits type to be used in this stream.
+ * @tparam Allocator allocator for the stream buffer object and its buffer
+ *                   (see nova::pool_allocator in nova/buffer_pool.h).
  *
  * @see sink
  * @see out_buffer_provider
  */
-template<typename Sink, typename Buffering = non_buffered, typename Traits = std::char_traits<typename Sink::char_type>>
+template<typename Sink, typename Buffering = non_buffered, typename Traits = std::char_traits<typename Sink::char_type>,
+         typename Allocator = std::allocator<typename Sink::char_type>>
 class outstream : public std::basic_ostream<typename Sink::char_type, Traits>
 {
-    typedef basic_outbuf<Sink, Buffering, Traits>                _outbuf_type;
+    typedef basic_outbuf<Sink, Buffering, Traits, Allocator>     _outbuf_type;
     typedef std::basic_ostream<typename Sink::char_type, Traits> _ostream_type;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<_outbuf_type> _alloc_type;
+    typedef std::allocator_traits<_alloc_type>                   _alloc_traits;
 public:
     /**
      * Character type to be used by this stream.
@@ -433,7 +1302,24 @@ public:
     template <class... Args>
     explicit outstream(Args&&... args) : _ostream_type{}
     {
-        _ostream_type::rdbuf(new _outbuf_type{std::forward<Args>(args)...});
+        _ostream_type::rdbuf(create(std::forward<Args>(args)...));
+    }
+    /**
+     * Constructor with buffering policy.
+     *
+     * Uses provided <code>Buffering</code> object (e.g. nova::dynamic_buffering
+     * with the buffer size chosen at run time) and passes the rest of the
+     * arguments to <code>Sink</code> constructor.
+     *
+     * @tparam Args types of the arguments to forward to <code>Sink</code> constructor
+     *
+     * @param buffering buffering policy object
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template <class... Args>
+    explicit outstream(Buffering buffering, Args&&... args) : _ostream_type{}
+    {
+        _ostream_type::rdbuf(create(buffering, std::forward<Args>(args)...));
     }
     /**
      * Move constructor
@@ -441,7 +1327,7 @@ public:
      * @param other <code>outstream</code> which contents and state will be acquired
      *              by created object.
      */
-    outstream(outstream&& other) noexcept : _ostream_type{}
+    outstream(outstream&& other) noexcept : _ostream_type{}, _alloc{std::move(other._alloc)}
     {
         _ostream_type::rdbuf(other.rdbuf());
         other.rdbuf(nullptr);
@@ -455,6 +1341,9 @@ public:
      */
     outstream& operator=(outstream&& other) noexcept
     {
+        if (this == &other) return *this;
+        destroy(buf());
+        _alloc = std::move(other._alloc);
         _ostream_type::rdbuf(other.rdbuf());
         other.rdbuf(nullptr);
         return *this;
@@ -463,7 +1352,7 @@ public:
     /**
      * Destructor.
      */
-    ~outstream() noexcept override { delete _ostream_type::rdbuf(); }
+    ~outstream() noexcept override { destroy(buf()); }
 
     /**
      * Provides access to the reference to the <code>Sink</code> instance
@@ -495,18 +1384,320 @@ public:
      */
     const Sink* operator->() const { return buf()->operator->(); }
 
+    /**
+     * Provides the stream buffer with its own type, as
+     * <code>std::basic_fstream::rdbuf</code> does.
+     *
+     * @return pointer to the nova::basic_outbuf of the stream.
+     */
+    _outbuf_type* rdbuf() const { return static_cast<_outbuf_type*>(_ostream_type::rdbuf()); }
+    using _ostream_type::rdbuf;
+
+    /**
+     * Zero-copy output: provides the free part of the stream buffer or of
+     * the buffer obtained from nova::out_buffer_provider. Not buffered
+     * streams over nova::sink have no such space and always return
+     * <code>{nullptr, 0}</code>.
+     *
+     * ~~~~~{.cpp}
+     * auto [buf, size] = out.out_span();
+     * std::size_t n = produce(buf, size);
+     * out.commit(n);
+     * ~~~~~
+     *
+     * @return pointer to the writable span and its size or <code>{nullptr, 0}</code>
+     *         if no more characters can be written.
+     */
+    std::pair<char_type*, std::size_t> out_span() { return buf()->out_span(); }
+    /**
+     * Marks <code>n</code> characters of the span returned by
+     * <code>out_span</code> as written.
+     *
+     * @param n number of characters written.
+     */
+    void commit(std::size_t n) { buf()->commit(n); }
+
+    /**
+     * Reserves <code>n</code> characters at the current position, to be
+     * filled in with <code>backpatch</code> once the characters following
+     * them are written, e.g. the length prefix of a frame:
+     *
+     * ~~~~~{.cpp}
+     * auto slot = out.reserve(sizeof(std::uint32_t));
+     * out << "id=" << id;
+     * auto size = static_cast<std::uint32_t>(out.tellp() - slot.end());
+     * out.backpatch(slot, reinterpret_cast<const char*>(&size));
+     * ~~~~~
+     *
+     * Buffered streams keep the output from the oldest open reservation on
+     * in the buffer, growing it for frames larger than the buffer, so
+     * flushes do not write past it and seeks fail. Streams over
+     * nova::out_buffer_provider need the reserved characters to fit into
+     * the rest of the provider's current buffer and hold back flushes the
+     * same way, but a frame running into the next provider buffer loses its
+     * reservation. Not buffered streams over nova::sink cannot reserve.
+     *
+     * @param n number of characters to reserve.
+     * @return the reservation or an empty one (setting <code>failbit</code>)
+     *         if the characters could not be reserved.
+     */
+    out_reservation reserve(std::size_t n)
+    {
+        out_reservation slot = buf()->reserve(n);
+        if (!slot) this->setstate(std::ios_base::failbit);
+        return slot;
+    }
+    /**
+     * Fills in the characters reserved with <code>reserve</code>. Filling
+     * in a reservation again does nothing.
+     *
+     * @param slot the reservation.
+     * @param s <code>slot.size</code> characters to write into it.
+     * @return <code>true</code> on success, <code>false</code> (setting
+     *         <code>badbit</code>) if the reservation was lost.
+     */
+    bool backpatch(const out_reservation& slot, const char_type* s)
+    {
+        if (buf()->backpatch(slot, s)) return true;
+        this->setstate(std::ios_base::badbit);
+        return false;
+    }
+
+    /**
+     * Reuses the stream for another sink without constructing a new stream
+     * object. The pending output goes to the current sink, which is then
+     * replaced with the one constructed from <code>args</code>. The buffer
+     * and the locale are kept; the stream state, formatting, exception
+     * mask and tied stream are reset to those of a new stream. If writing
+     * the pending output or constructing the new <code>Sink</code> throws,
+     * the stream is left with <code>badbit</code> set and the exception is
+     * propagated.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template <class... Args>
+    void rebind(Args&&... args)
+    {
+        try
+        {
+            if (buf()) buf()->rebind(std::forward<Args>(args)...);
+            else _ostream_type::rdbuf(create(std::forward<Args>(args)...));
+        }
+        catch (...)
+        {
+            _reset_ios(*this);
+            this->setstate(std::ios_base::badbit);
+            throw;
+        }
+        _reset_ios(*this);
+    }
+
 private:
+    template <class... Args>
+    _outbuf_type* create(Args&&... args)
+    {
+        _outbuf_type* outbuf = _alloc_traits::allocate(_alloc, 1);
+        try
+        {
+            _alloc_traits::construct(_alloc, outbuf, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            _alloc_traits::deallocate(_alloc, outbuf, 1);
+            throw;
+        }
+        return outbuf;
+    }
+
+    void destroy(_outbuf_type* outbuf) noexcept
+    {
+        if (!outbuf) return;
+        _alloc_traits::destroy(_alloc, outbuf);
+        _alloc_traits::deallocate(_alloc, outbuf, 1);
+    }
+
     inline _outbuf_type *buf() { return static_cast<_outbuf_type*>(_ostream_type::rdbuf()); }
     inline const _outbuf_type *buf() const { return static_cast<const _outbuf_type*>(_ostream_type::rdbuf()); }
+
+    _alloc_type _alloc;
+};
+
+/* Base-from-member: the stream buffer has to be constructed before the stream. */
+template<typename Buf>
+struct _streambuf_holder
+{
+    template<class... Args>
+    explicit _streambuf_holder(Args&&... args) : _streambuf{std::forward<Args>(args)...} {}
+
+    Buf _streambuf;
 };
 
-template<typename Source, typename Buffering, typename Traits, typename Enable = void>
+/**
+ * Output stream with the stream buffer stored inside the stream object.
+ *
+ * It is the same as nova::outstream, except that creating it allocates
+ * nothing but the buffer of a buffered stream (which comes from
+ * <code>Allocator</code>, see nova::pool_allocator) and that access to the
+ * <code>Sink</code> needs no indirection. Moving the stream moves the
+ * <code>Sink</code>, so the <code>Sink</code> must be movable for the
+ * stream to be; buffers of nova::out_buffer_provider must not live inside
+ * the provider object.
+ *
+ * @tparam Sink sink object to use to write data.
+ * @tparam Buffering Buffer size or buffering policy to be used (see
+ *                   nova::buffering). It must be nova::non_buffered
+ *                   if nova::out_buffer_provider is used as
+ *                   <code>Sink</code>
+ * @tparam Traits character traits type to be used in this stream.
+ * @tparam Allocator allocator for the buffer.
+ *
+ * @see outstream
+ */
+template<typename Sink, typename Buffering = non_buffered, typename Traits = std::char_traits<typename Sink::char_type>,
+         typename Allocator = std::allocator<typename Sink::char_type>>
+class inline_outstream : private _streambuf_holder<basic_outbuf<Sink, Buffering, Traits, Allocator>>,
+                         public std::basic_ostream<typename Sink::char_type, Traits>
+{
+    typedef basic_outbuf<Sink, Buffering, Traits, Allocator>     _outbuf_type;
+    typedef _streambuf_holder<_outbuf_type>                      _holder_type;
+    typedef std::basic_ostream<typename Sink::char_type, Traits> _ostream_type;
+public:
+    typedef typename Sink::char_type       char_type;
+    typedef Traits                         traits_type;
+    typedef typename traits_type::int_type int_type;
+    typedef typename traits_type::pos_type pos_type;
+    typedef typename traits_type::off_type off_type;
+
+    /**
+     * Main constructor.
+     *
+     * The arguments are passed to <code>Sink</code> constructor; the first
+     * one may be <code>Buffering</code> object as for nova::outstream.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template <class... Args>
+    explicit inline_outstream(Args&&... args) :
+            _holder_type{std::forward<Args>(args)...}, _ostream_type{&this->_streambuf} {}
+    /**
+     * Move constructor. Takes over the sink, the buffer and the stream state.
+     *
+     * @param other <code>inline_outstream</code> to move from.
+     */
+    inline_outstream(inline_outstream&& other) :
+            _holder_type{std::move(other._streambuf)}, _ostream_type{std::move(other)}
+    {
+        _ostream_type::set_rdbuf(&this->_streambuf);
+        other.rdbuf(nullptr);
+    }
+    /**
+     * Move assignment operator. The pending output of this stream is
+     * written first. It is <code>noexcept</code> when moving the
+     * <code>Sink</code> cannot throw. Otherwise the stream buffer of
+     * <code>other</code> is first moved aside: an exception from that move
+     * leaves this stream unchanged, though <code>other</code> may be left
+     * with a moved-from <code>Sink</code>; an exception from moving it into
+     * place calls <code>std::terminate</code>.
+     *
+     * @param other <code>inline_outstream</code> to move from.
+     * @return reference to self
+     */
+    inline_outstream& operator=(inline_outstream&& other)
+            noexcept(std::is_nothrow_move_constructible<_outbuf_type>::value)
+    {
+        if (this == &other) return *this;
+        _move_streambuf(this->_streambuf, other._streambuf, std::is_nothrow_move_constructible<_outbuf_type>{});
+        _ostream_type::operator=(std::move(other));
+        _ostream_type::set_rdbuf(&this->_streambuf);
+        other.rdbuf(nullptr);
+        return *this;
+    }
+
+    inline_outstream(const inline_outstream& ) = delete;
+    inline_outstream& operator=(const inline_outstream& ) = delete;
+
+    Sink& operator*() { return *this->_streambuf; }
+    Sink* operator->() { return this->_streambuf.operator->(); }
+
+    const Sink& operator*() const { return *this->_streambuf; }
+    const Sink* operator->() const { return this->_streambuf.operator->(); }
+
+    /**
+     * Provides the stream buffer with its own type, as
+     * <code>std::basic_fstream::rdbuf</code> does.
+     *
+     * @return pointer to the nova::basic_outbuf of the stream.
+     */
+    _outbuf_type* rdbuf() const { return static_cast<_outbuf_type*>(_ostream_type::rdbuf()); }
+    using _ostream_type::rdbuf;
+
+    /**
+     * @see outstream::out_span
+     */
+    std::pair<char_type*, std::size_t> out_span() { return this->_streambuf.out_span(); }
+    /**
+     * @see outstream::commit
+     */
+    void commit(std::size_t n) { this->_streambuf.commit(n); }
+    /**
+     * @see outstream::reserve
+     */
+    out_reservation reserve(std::size_t n)
+    {
+        out_reservation slot = this->_streambuf.reserve(n);
+        if (!slot) this->setstate(std::ios_base::failbit);
+        return slot;
+    }
+    /**
+     * @see outstream::backpatch
+     */
+    bool backpatch(const out_reservation& slot, const char_type* s)
+    {
+        if (this->_streambuf.backpatch(slot, s)) return true;
+        this->setstate(std::ios_base::badbit);
+        return false;
+    }
+
+    /**
+     * Reuses the stream for another sink without constructing a new stream
+     * object. The pending output goes to the current sink, which is then
+     * replaced with the one constructed from <code>args</code>. The buffer
+     * and the locale are kept; the stream state, formatting, exception
+     * mask and tied stream are reset to those of a new stream. If writing
+     * the pending output or constructing the new <code>Sink</code> throws,
+     * the stream is left with <code>badbit</code> set and the exception is
+     * propagated.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template <class... Args>
+    void rebind(Args&&... args)
+    {
+        if (!_ostream_type::rdbuf()) _ostream_type::set_rdbuf(&this->_streambuf);
+        try
+        {
+            this->_streambuf.rebind(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            _reset_ios(*this);
+            this->setstate(std::ios_base::badbit);
+            throw;
+        }
+        _reset_ios(*this);
+    }
+};
+
+template<typename Source, typename Buffering, typename Traits,
+         typename Allocator = std::allocator<typename Source::char_type>, typename Enable = void>
 class basic_inbuf;
 
-template<typename Source, typename Buffering, typename Traits, typename Enable>
+template<typename Source, typename Buffering, typename Traits, typename Allocator, typename Enable>
 class basic_inbuf : public std::basic_streambuf<typename Source::char_type, Traits>
 {
     typedef std::basic_streambuf<typename Source::char_type, Traits> _buf_type;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<typename Source::char_type> _alloc_type;
+    typedef std::allocator_traits<_alloc_type> _alloc_traits;
 public:
     typedef typename Source::char_type char_type;
     typedef Traits                     traits_type;
@@ -516,12 +1707,24 @@ public:
 
     template <class... Args>
     explicit basic_inbuf(Args&&... args) :
-            _source{std::forward<Args>(args)...}, _buffer{new char_type[Buffering::buf_size]} {}
+            _source{std::forward<Args>(args)...}, _buffering{}, _alloc{}, _capacity{_buffering.size()},
+            _buffer{_alloc_traits::allocate(_alloc, _capacity)} {}
 
-    ~basic_inbuf() noexcept override { delete[] _buffer; }
+    template <class... Args>
+    explicit basic_inbuf(Buffering buffering, Args&&... args) :
+            _source{std::forward<Args>(args)...}, _buffering{buffering}, _alloc{}, _capacity{_buffering.size()},
+            _buffer{_alloc_traits::allocate(_alloc, _capacity)} {}
+
+    ~basic_inbuf() noexcept override { if (_buffer) _alloc_traits::deallocate(_alloc, _buffer, _capacity); }
 
     basic_inbuf(const basic_inbuf& ) = delete;
-    basic_inbuf(basic_inbuf&& other) = delete;
+    basic_inbuf(basic_inbuf&& other)
+            noexcept(std::is_nothrow_move_constructible<Source>::value && std::is_nothrow_copy_constructible<Buffering>::value) :
+            _buf_type{other}, _source{std::move(other._source)}, _buffering{other._buffering}, _alloc{other._alloc},
+            _capacity{std::exchange(other._capacity, 0)}, _buffer{std::exchange(other._buffer, nullptr)}, _pos{other._pos}
+    {
+        other.setg(nullptr, nullptr, nullptr);
+    }
 
     basic_inbuf& operator=(const basic_inbuf& ) = delete;
     basic_inbuf& operator=(basic_inbuf&& ) = delete;
@@ -532,17 +1735,104 @@ public:
     const Source& operator*() const { return _source; }
     const Source* operator->() const { return &_source; }
 
+    /**
+     * Accounts for <code>n</code> characters the source moved past outside
+     * of the stream buffer (see nova::copy). Must be called with no unread
+     * characters in the buffer.
+     */
+    void transferred(std::streamsize n)
+    {
+        _pos += n;
+        /* The old buffer content is not at the new position. */
+        _buf_type::setg(_buffer, _buffer, _buffer);
+    }
+
     void reset() { }
 
+    /**
+     * Replaces the source with the one constructed from <code>args</code>,
+     * discarding the unread characters and keeping the buffer.
+     */
+    template <class... Args>
+    void rebind(Args&&... args)
+    {
+        _pos = 0;
+        _buf_type::setg(nullptr, nullptr, nullptr);
+        _recreate(_source, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Provides direct access to the unread part of the stream buffer,
+     * refilling it from the source if it is exhausted. The characters are
+     * not consumed until <code>consume</code> is called.
+     *
+     * @return pointer to the readable span and its size or <code>{nullptr, 0}</code>
+     *         if the source has no more data.
+     */
+    std::pair<const char_type*, std::size_t> in_span()
+    {
+        if (_buf_type::gptr() == _buf_type::egptr() &&
+            traits_type::eq_int_type(underflow(), traits_type::eof())) return {nullptr, 0};
+        return {_buf_type::gptr(), static_cast<std::size_t>(_buf_type::egptr() - _buf_type::gptr())};
+    }
+
+    /**
+     * Marks <code>n</code> characters of the span returned by
+     * <code>in_span</code> as read.
+     *
+     * @param n number of characters read, must not exceed the span size.
+     */
+    void consume(std::size_t n) { _buf_type::gbump(static_cast<int>(n)); }
+
 protected:
     int_type underflow() override
     {
-        std::streamsize new_size = _source.read(_buffer, Buffering::buf_size);
-        if (new_size == 0) return traits_type::eof();
+        std::size_t size = _buffering.size();
+        if (size != _capacity)
+        {
+            if (_buffer) _alloc_traits::deallocate(_alloc, _buffer, _capacity);
+            _buffer = _alloc_traits::allocate(_alloc, size);
+            _capacity = size;
+        }
+        std::streamsize new_size = _source.read(_buffer, static_cast<std::streamsize>(size));
+        if (new_size <= 0)
+        {
+            _buf_type::setg(_buffer, _buffer, _buffer);
+            return traits_type::eof();
+        }
+        _buffering.next_size(static_cast<std::size_t>(new_size));
         _buf_type::setg(_buffer, _buffer, _buffer + new_size);
+        _pos += new_size;
         return traits_type::to_int_type(*_buffer);
     }
 
+    std::streamsize xsgetn(char_type* s, std::streamsize n) override
+    {
+        std::streamsize done = 0;
+        while (done < n)
+        {
+            std::streamsize avail = _buf_type::egptr() - _buf_type::gptr();
+            if (avail > 0)
+            {
+                std::streamsize chunk = avail < n - done ? avail : n - done;
+                traits_type::copy(s + done, _buf_type::gptr(), static_cast<std::size_t>(chunk));
+                _buf_type::gbump(static_cast<int>(chunk));
+                done += chunk;
+            }
+            else if (n - done >= static_cast<std::streamsize>(_buffering.size()))
+            {
+                /* The rest is at least a buffer long: read it straight into the caller's memory. */
+                _buf_type::setg(_buffer, _buffer, _buffer);
+                std::streamsize read = _source.read(s + done, n - done);
+                if (read <= 0) break;
+                _pos += read;
+                done += read;
+            }
+            else if (traits_type::eq_int_type(underflow(), traits_type::eof())) break;
+        }
+        return done;
+    }
+
     int_type pbackfail(int_type ch) override
     {
         if (_buf_type::egptr() <= _buf_type::eback()) return traits_type::eof();
@@ -550,13 +1840,53 @@ protected:
         return ch;
     }
 
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        off_type cur = _pos - (_buf_type::egptr() - _buf_type::gptr());
+        if (dir == std::ios_base::cur && off == 0) return pos_type(cur);
+        return seek_to(off, dir, cur, is_seekable<Source>{});
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
 private:
+    pos_type seek_to(off_type off, std::ios_base::seekdir dir, off_type cur, std::true_type)
+    {
+        if (dir == std::ios_base::cur) off += cur;
+        if (dir != std::ios_base::end)
+        {
+            if (off < 0) return pos_type(off_type(-1));
+            /* Target within the current buffer: no need to touch the source. */
+            off_type start = _pos - (_buf_type::egptr() - _buf_type::eback());
+            if (off >= start && off <= _pos)
+            {
+                _buf_type::setg(_buf_type::eback(), _buf_type::eback() + (off - start), _buf_type::egptr());
+                return pos_type(off);
+            }
+        }
+        std::streamoff res = _source.seek(off, dir == std::ios_base::end ? dir : std::ios_base::beg);
+        if (res < 0) return pos_type(off_type(-1));
+        _pos = res;
+        _buf_type::setg(_buffer, _buffer, _buffer);
+        return pos_type(res);
+    }
+    pos_type seek_to(off_type, std::ios_base::seekdir, off_type, std::false_type) { return pos_type(off_type(-1)); }
+
     Source _source;
+    Buffering _buffering;
+    _alloc_type _alloc;
+    std::size_t _capacity;
     char_type *_buffer;
+    /* Source position of egptr(). */
+    off_type _pos = 0;
 };
 
-template<typename Source, typename Traits, typename Enable>
-class basic_inbuf<Source, non_buffered, Traits, Enable> :
+template<typename Source, typename Traits, typename Allocator, typename Enable>
+class basic_inbuf<Source, non_buffered, Traits, Allocator, Enable> :
         public std::basic_streambuf<typename Source::char_type, Traits>
 {
     typedef std::basic_streambuf<typename Source::char_type, Traits> _buf_type;
@@ -573,7 +1903,13 @@ public:
     ~basic_inbuf() noexcept override = default;
 
     basic_inbuf(const basic_inbuf& ) = delete;
-    basic_inbuf(basic_inbuf&& other) = delete;
+    basic_inbuf(basic_inbuf&& other) noexcept(std::is_nothrow_move_constructible<Source>::value) :
+            _buf_type{other}, _source{std::move(other._source)}, _ch{other._ch}, _pos{other._pos}
+    {
+        /* The get area is the one character inside the object. */
+        if (_buf_type::eback()) _buf_type::setg(&_ch, &_ch + (_buf_type::gptr() - _buf_type::eback()), &_ch + 1);
+        other.setg(nullptr, nullptr, nullptr);
+    }
 
     basic_inbuf& operator=(const basic_inbuf& ) = delete;
     basic_inbuf& operator=(basic_inbuf&& ) = delete;
@@ -584,16 +1920,86 @@ public:
     const Source& operator*() const { return _source; }
     const Source* operator->() const { return &_source; }
 
+    /**
+     * Accounts for <code>n</code> characters the source moved past outside
+     * of the stream buffer (see nova::copy). Must be called with no unread
+     * characters in the buffer.
+     */
+    void transferred(std::streamsize n)
+    {
+        _pos += n;
+        _buf_type::setg(nullptr, nullptr, nullptr);
+    }
+
     void reset() { }
 
+    /**
+     * Replaces the source with the one constructed from <code>args</code>,
+     * discarding the unread character.
+     */
+    template <class... Args>
+    void rebind(Args&&... args)
+    {
+        _pos = 0;
+        _buf_type::setg(nullptr, nullptr, nullptr);
+        _recreate(_source, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Provides direct access to the unread part of the stream buffer,
+     * refilling it from the source if it is exhausted. The characters are
+     * not consumed until <code>consume</code> is called.
+     *
+     * @return pointer to the readable span and its size or <code>{nullptr, 0}</code>
+     *         if the source has no more data.
+     */
+    std::pair<const char_type*, std::size_t> in_span()
+    {
+        if (_buf_type::gptr() == _buf_type::egptr() &&
+            traits_type::eq_int_type(underflow(), traits_type::eof())) return {nullptr, 0};
+        return {_buf_type::gptr(), static_cast<std::size_t>(_buf_type::egptr() - _buf_type::gptr())};
+    }
+
+    /**
+     * Marks <code>n</code> characters of the span returned by
+     * <code>in_span</code> as read.
+     *
+     * @param n number of characters read, must not exceed the span size.
+     */
+    void consume(std::size_t n) { _buf_type::gbump(static_cast<int>(n)); }
+
 protected:
     int_type underflow() override
     {
         if (_source.read(&_ch, 1) == 0) return traits_type::eof();
         _buf_type::setg(&_ch, &_ch, &_ch + 1);
+        ++_pos;
         return traits_type::to_int_type(_ch);
     }
 
+    std::streamsize xsgetn(char_type* s, std::streamsize n) override
+    {
+        if (n <= 0) return 0;
+        std::streamsize done = 0;
+        if (_buf_type::gptr() != _buf_type::egptr())
+        {
+            /* The character left by underflow goes first. */
+            *s = _ch;
+            _buf_type::gbump(1);
+            done = 1;
+        }
+        /* The rest is read straight into the caller's memory. */
+        _buf_type::setg(nullptr, nullptr, nullptr);
+        while (done < n)
+        {
+            std::streamsize read = _source.read(s + done, n - done);
+            if (read <= 0) break;
+            _pos += read;
+            done += read;
+        }
+        return done;
+    }
+
     int_type pbackfail(int_type ch) override
     {
         if (_buf_type::egptr() <= _buf_type::eback()) return traits_type::eof();
@@ -601,13 +2007,49 @@ protected:
         return ch;
     }
 
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        off_type cur = _pos - (_buf_type::egptr() - _buf_type::gptr());
+        if (dir == std::ios_base::cur && off == 0) return pos_type(cur);
+        return seek_to(off, dir, cur, is_seekable<Source>{});
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
 private:
+    pos_type seek_to(off_type off, std::ios_base::seekdir dir, off_type cur, std::true_type)
+    {
+        if (dir == std::ios_base::cur) off += cur;
+        if (dir != std::ios_base::end)
+        {
+            if (off < 0) return pos_type(off_type(-1));
+            /* Target within the current buffer: no need to touch the source. */
+            off_type start = _pos - (_buf_type::egptr() - _buf_type::eback());
+            if (off >= start && off <= _pos)
+            {
+                _buf_type::setg(_buf_type::eback(), _buf_type::eback() + (off - start), _buf_type::egptr());
+                return pos_type(off);
+            }
+        }
+        std::streamoff res = _source.seek(off, dir == std::ios_base::end ? dir : std::ios_base::beg);
+        if (res < 0) return pos_type(off_type(-1));
+        _pos = res;
+        _buf_type::setg(nullptr, nullptr, nullptr);
+        return pos_type(res);
+    }
+    pos_type seek_to(off_type, std::ios_base::seekdir, off_type, std::false_type) { return pos_type(off_type(-1)); }
+
     Source _source;
     char_type _ch;
+    off_type _pos = 0;
 };
 
-template<typename Source, typename Traits>
-class basic_inbuf<Source, non_buffered, Traits,
+template<typename Source, typename Traits, typename Allocator>
+class basic_inbuf<Source, non_buffered, Traits, Allocator,
                   typename std::enable_if_t<std::is_same<typename Source::category, in_buffer_provider>::value>> :
         public std::basic_streambuf<typename Source::char_type, Traits>
 {
@@ -622,10 +2064,18 @@ public:
     template <class... Args>
     explicit basic_inbuf(Args&&... args) : _source{std::forward<Args>(args)...} {}
 
-    ~basic_inbuf() noexcept override = default;
+    ~basic_inbuf() noexcept override { release_span(releases_in_buffer<Source>{}); }
 
     basic_inbuf(const basic_inbuf& ) = delete;
-    basic_inbuf(basic_inbuf&& other) = delete;
+    /**
+     * Takes over the source and the unread part of its current buffer,
+     * which must not live inside the source object.
+     */
+    basic_inbuf(basic_inbuf&& other) noexcept(std::is_nothrow_move_constructible<Source>::value) :
+            _buf_type{other}, _source{std::move(other._source)}, _pos{other._pos}
+    {
+        other.setg(nullptr, nullptr, nullptr);
+    }
 
     basic_inbuf& operator=(const basic_inbuf& ) = delete;
     basic_inbuf& operator=(basic_inbuf&& ) = delete;
@@ -636,26 +2086,98 @@ public:
     const Source& operator*() const { return _source; }
     const Source* operator->() const { return &_source; }
 
+    /**
+     * Accounts for <code>n</code> characters the source moved past outside
+     * of the stream buffer (see nova::copy). Must be called with no unread
+     * characters in the buffer.
+     */
+    void transferred(std::streamsize n)
+    {
+        release_span(releases_in_buffer<Source>{});
+        _pos += n;
+        _buf_type::setg(nullptr, nullptr, nullptr);
+    }
+
     void reset() { _buf_type::setg(_buf_type::eback(), _buf_type::eback(), _buf_type::egptr()); }
 
+    /**
+     * Replaces the provider with the one constructed from <code>args</code>,
+     * discarding the unread part of its buffer.
+     */
+    template <class... Args>
+    void rebind(Args&&... args)
+    {
+        release_span(releases_in_buffer<Source>{});
+        _pos = 0;
+        _buf_type::setg(nullptr, nullptr, nullptr);
+        _recreate(_source, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Provides direct access to the unread part of the current provider's
+     * buffer, requesting the next buffer from the provider if the current
+     * one is exhausted. The characters are not consumed until
+     * <code>consume</code> is called.
+     *
+     * @return pointer to the readable span and its size or <code>{nullptr, 0}</code>
+     *         if the provider has no more data.
+     */
+    std::pair<const char_type*, std::size_t> in_span()
+    {
+        if (_buf_type::gptr() == _buf_type::egptr() &&
+            traits_type::eq_int_type(underflow(), traits_type::eof())) return {nullptr, 0};
+        return {_buf_type::gptr(), static_cast<std::size_t>(_buf_type::egptr() - _buf_type::gptr())};
+    }
+
+    /**
+     * Marks <code>n</code> characters of the span returned by
+     * <code>in_span</code> as read.
+     *
+     * @param n number of characters read, must not exceed the span size.
+     */
+    void consume(std::size_t n)
+    {
+        for (; n > INT_MAX; n -= INT_MAX) _buf_type::gbump(INT_MAX);
+        _buf_type::gbump(static_cast<int>(n));
+    }
+
 protected:
+    std::streamsize xsgetn(char_type* s, std::streamsize n) override
+    {
+        std::streamsize done = 0;
+        while (done < n)
+        {
+            if (_buf_type::gptr() == _buf_type::egptr() &&
+                traits_type::eq_int_type(underflow(), traits_type::eof())) break;
+            std::streamsize avail = _buf_type::egptr() - _buf_type::gptr();
+            std::streamsize chunk = avail < n - done ? avail : n - done;
+            traits_type::copy(s + done, _buf_type::gptr(), static_cast<std::size_t>(chunk));
+            consume(static_cast<std::size_t>(chunk));
+            done += chunk;
+        }
+        return done;
+    }
+
     int_type underflow() override
     {
         /* This code casts const away. I know that we are not supposed to do this. But, unfortunately
          * the std::basic_streambuf requires non-const pointers in setg. One way around it: we could require
          * in_buffer_provider::get_in_buffer to return non-const buffer which would have been weird requirement
          * for read only buffer. */
+        release_span(releases_in_buffer<Source>{});
 #if __cplusplus > 201700L
         auto [buf, size] = _source.get_in_buffer();
         if (!buf || size <= 0) return traits_type::eof();
         auto non_const_buf = const_cast<char_type*>(buf);
         _buf_type::setg(non_const_buf, non_const_buf, non_const_buf + size);
+        _pos += static_cast<off_type>(size);
         return traits_type::to_int_type(*_buf_type::eback());
 #else
         auto res = _source.get_in_buffer();
         if (!res.first || res.second <= 0) return traits_type::eof();
         auto non_const_buf = const_cast<char_type*>(res.first);
         _buf_type::setg(non_const_buf, non_const_buf, non_const_buf + res.second);
+        _pos += static_cast<off_type>(res.second);
         return traits_type::to_int_type(*_buf_type::eback());
 #endif
     }
@@ -667,8 +2189,57 @@ protected:
         return ch;
     }
 
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        off_type cur = _pos - (_buf_type::egptr() - _buf_type::gptr());
+        if (dir == std::ios_base::cur && off == 0) return pos_type(cur);
+        return seek_to(off, dir, cur, is_seekable<Source>{});
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
 private:
+    pos_type seek_to(off_type off, std::ios_base::seekdir dir, off_type cur, std::true_type)
+    {
+        if (dir == std::ios_base::cur) off += cur;
+        if (dir != std::ios_base::end)
+        {
+            if (off < 0) return pos_type(off_type(-1));
+            /* Target within the current buffer: no need to touch the source. */
+            off_type start = _pos - (_buf_type::egptr() - _buf_type::eback());
+            if (off >= start && off <= _pos)
+            {
+                _buf_type::setg(_buf_type::eback(), _buf_type::eback() + (off - start), _buf_type::egptr());
+                return pos_type(off);
+            }
+        }
+        release_span(releases_in_buffer<Source>{});
+        std::streamoff res = _source.seek(off, dir == std::ios_base::end ? dir : std::ios_base::beg);
+        if (res < 0) return pos_type(off_type(-1));
+        _pos = res;
+        _buf_type::setg(nullptr, nullptr, nullptr);
+        return pos_type(res);
+    }
+    pos_type seek_to(off_type, std::ios_base::seekdir, off_type, std::false_type) { return pos_type(off_type(-1)); }
+
+    /* Tells the provider the stream is done with the current span and
+     * drops it, the unread part will come with the next buffer. */
+    void release_span(std::true_type)
+    {
+        if (!_buf_type::eback()) return;
+        _source.release_in_buffer(_buf_type::eback(), static_cast<std::size_t>(_buf_type::gptr() - _buf_type::eback()));
+        _pos -= _buf_type::egptr() - _buf_type::gptr();
+        _buf_type::setg(nullptr, nullptr, nullptr);
+    }
+    void release_span(std::false_type) { }
+
     Source _source;
+    /* Source position of egptr(). */
+    off_type _pos = 0;
 };
 
 /**
@@ -682,20 +2253,26 @@ private:
  * specifications of wither nova::source or nova::in_buffer_provider.
  *
  * @tparam Source source type to use to read data from.
- * @tparam Buffering Buffer size to be used. It must be nova::non_buffered
+ * @tparam Buffering Buffer size or buffering policy to be used (see
+ *                   nova::buffering). It must be nova::non_buffered
  *                   if <code>in_buffer_provider</code> is used as
  *                   <code>Source</code>
  * @tparam Traits character traits type to be used in this stream.
+ * @tparam Allocator allocator for the stream buffer object and its buffer
+ *                   (see nova::pool_allocator in nova/buffer_pool.h).
  *
  * @see source
  * @see in_buffer_provider
  */
 template<typename Source, typename Buffering = non_buffered,
-         typename Traits = std::char_traits<typename Source::char_type>>
+         typename Traits = std::char_traits<typename Source::char_type>,
+         typename Allocator = std::allocator<typename Source::char_type>>
 class instream : public std::basic_istream<typename Source::char_type, Traits>
 {
-    typedef basic_inbuf<Source, Buffering, Traits>                 _inbuf_type;
+    typedef basic_inbuf<Source, Buffering, Traits, Allocator>      _inbuf_type;
     typedef std::basic_istream<typename Source::char_type, Traits> _istream_type;
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<_inbuf_type> _alloc_type;
+    typedef std::allocator_traits<_alloc_type>                     _alloc_traits;
 public:
     /**
      * Character type to be used by this stream.
@@ -731,7 +2308,24 @@ public:
     template <typename... Args>
     explicit instream(Args&&... args) : _istream_type{}
     {
-        _istream_type::rdbuf(new _inbuf_type{std::forward<Args>(args)...});
+        _istream_type::rdbuf(create(std::forward<Args>(args)...));
+    }
+    /**
+     * Constructor with buffering policy.
+     *
+     * Uses provided <code>Buffering</code> object (e.g. nova::dynamic_buffering
+     * with the buffer size chosen at run time) and passes the rest of the
+     * arguments to <code>Source</code> constructor.
+     *
+     * @tparam Args types of the arguments to forward to <code>Source</code> constructor
+     *
+     * @param buffering buffering policy object
+     * @param args Arguments to be forwarded to construct the <code>Source</code>
+     */
+    template <typename... Args>
+    explicit instream(Buffering buffering, Args&&... args) : _istream_type{}
+    {
+        _istream_type::rdbuf(create(buffering, std::forward<Args>(args)...));
     }
     /**
      * Copying is prohibited.
@@ -743,7 +2337,7 @@ public:
      * @param other <code>instream</code> which contents and state will be acquired
      *              by created object.
      */
-    instream(instream&& other) noexcept : _istream_type{}
+    instream(instream&& other) noexcept : _istream_type{}, _alloc{std::move(other._alloc)}
     {
         _istream_type::rdbuf(other.rdbuf());
         other.rdbuf(nullptr);
@@ -758,6 +2352,9 @@ public:
      */
     instream& operator=(instream&& other) noexcept
     {
+        if (this == &other) return *this;
+        destroy(buf());
+        _alloc = std::move(other._alloc);
         _istream_type::rdbuf(other.rdbuf());
         other.rdbuf(nullptr);
         return *this;
@@ -766,7 +2363,7 @@ public:
     /**
      * Destructor
      */
-    ~instream() noexcept override { delete _istream_type::rdbuf(); }
+    ~instream() noexcept override { destroy(buf()); }
 
     /**
      * Provides access to the reference to the <code>Source</code> instance
@@ -794,9 +2391,231 @@ public:
      */
     const Source* operator->() const { return buf()->operator->(); }
 
+    /**
+     * Provides the stream buffer with its own type, as
+     * <code>std::basic_fstream::rdbuf</code> does.
+     *
+     * @return pointer to the nova::basic_inbuf of the stream.
+     */
+    _inbuf_type* rdbuf() const { return static_cast<_inbuf_type*>(_istream_type::rdbuf()); }
+    using _istream_type::rdbuf;
+
+    /**
+     * Zero-copy input: provides the unread part of the stream buffer or of
+     * the buffer obtained from nova::in_buffer_provider. Not buffered
+     * streams over nova::source provide one character at a time.
+     *
+     * ~~~~~{.cpp}
+     * auto [buf, size] = in.in_span();
+     * in.consume(parse(buf, size));
+     * ~~~~~
+     *
+     * @return pointer to the readable span and its size or <code>{nullptr, 0}</code>
+     *         if there is no more data.
+     */
+    std::pair<const char_type*, std::size_t> in_span() { return buf()->in_span(); }
+    /**
+     * Marks <code>n</code> characters of the span returned by
+     * <code>in_span</code> as read.
+     *
+     * @param n number of characters read.
+     */
+    void consume(std::size_t n) { buf()->consume(n); }
+
+    /**
+     * Reuses the stream for another source without constructing a new
+     * stream object. The unread characters are discarded and the source is
+     * replaced with the one constructed from <code>args</code>. The buffer
+     * and the locale are kept; the stream state, formatting, exception
+     * mask and tied stream are reset to those of a new stream. If
+     * constructing the new <code>Source</code> throws, the stream is left
+     * with <code>badbit</code> set and the exception is propagated.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Source</code>
+     */
+    template <typename... Args>
+    void rebind(Args&&... args)
+    {
+        try
+        {
+            if (buf()) buf()->rebind(std::forward<Args>(args)...);
+            else _istream_type::rdbuf(create(std::forward<Args>(args)...));
+        }
+        catch (...)
+        {
+            _reset_ios(*this);
+            this->setstate(std::ios_base::badbit);
+            throw;
+        }
+        _reset_ios(*this);
+    }
+
 private:
+    template <typename... Args>
+    _inbuf_type* create(Args&&... args)
+    {
+        _inbuf_type* inbuf = _alloc_traits::allocate(_alloc, 1);
+        try
+        {
+            _alloc_traits::construct(_alloc, inbuf, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            _alloc_traits::deallocate(_alloc, inbuf, 1);
+            throw;
+        }
+        return inbuf;
+    }
+
+    void destroy(_inbuf_type* inbuf) noexcept
+    {
+        if (!inbuf) return;
+        _alloc_traits::destroy(_alloc, inbuf);
+        _alloc_traits::deallocate(_alloc, inbuf, 1);
+    }
+
     inline _inbuf_type* buf() { return static_cast<_inbuf_type*>(_istream_type::rdbuf()); }
     inline const _inbuf_type* buf() const { return static_cast<const _inbuf_type*>(_istream_type::rdbuf()); }
+
+    _alloc_type _alloc;
+};
+
+/**
+ * Input stream with the stream buffer stored inside the stream object.
+ *
+ * It is the same as nova::instream, except that creating it allocates
+ * nothing but the buffer of a buffered stream (which comes from
+ * <code>Allocator</code>, see nova::pool_allocator) and that access to the
+ * <code>Source</code> needs no indirection. Moving the stream moves the
+ * <code>Source</code>, so the <code>Source</code> must be movable for the
+ * stream to be; buffers of nova::in_buffer_provider must not live inside
+ * the provider object.
+ *
+ * @tparam Source source object to use to read data from.
+ * @tparam Buffering Buffer size or buffering policy to be used (see
+ *                   nova::buffering). It must be nova::non_buffered
+ *                   if nova::in_buffer_provider is used as
+ *                   <code>Source</code>
+ * @tparam Traits character traits type to be used in this stream.
+ * @tparam Allocator allocator for the buffer.
+ *
+ * @see instream
+ */
+template<typename Source, typename Buffering = non_buffered,
+         typename Traits = std::char_traits<typename Source::char_type>,
+         typename Allocator = std::allocator<typename Source::char_type>>
+class inline_instream : private _streambuf_holder<basic_inbuf<Source, Buffering, Traits, Allocator>>,
+                        public std::basic_istream<typename Source::char_type, Traits>
+{
+    typedef basic_inbuf<Source, Buffering, Traits, Allocator>      _inbuf_type;
+    typedef _streambuf_holder<_inbuf_type>                         _holder_type;
+    typedef std::basic_istream<typename Source::char_type, Traits> _istream_type;
+public:
+    typedef typename Source::char_type     char_type;
+    typedef Traits                         traits_type;
+    typedef typename traits_type::int_type int_type;
+    typedef typename traits_type::pos_type pos_type;
+    typedef typename traits_type::off_type off_type;
+
+    /**
+     * Main constructor.
+     *
+     * The arguments are passed to <code>Source</code> constructor; the first
+     * one may be <code>Buffering</code> object as for nova::instream.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Source</code>
+     */
+    template <typename... Args>
+    explicit inline_instream(Args&&... args) :
+            _holder_type{std::forward<Args>(args)...}, _istream_type{&this->_streambuf} {}
+    /**
+     * Move constructor. Takes over the source, the unread buffer and the
+     * stream state.
+     *
+     * @param other <code>inline_instream</code> to move from.
+     */
+    inline_instream(inline_instream&& other) :
+            _holder_type{std::move(other._streambuf)}, _istream_type{std::move(other)}
+    {
+        _istream_type::set_rdbuf(&this->_streambuf);
+        other.rdbuf(nullptr);
+    }
+    /**
+     * Move assignment operator. It is <code>noexcept</code> when moving
+     * the <code>Source</code> cannot throw. Otherwise the stream buffer of
+     * <code>other</code> is first moved aside: an exception from that move
+     * leaves this stream unchanged, though <code>other</code> may be left
+     * with a moved-from <code>Source</code>; an exception from moving it
+     * into place calls <code>std::terminate</code>.
+     *
+     * @param other <code>inline_instream</code> to move from.
+     * @return reference to self
+     */
+    inline_instream& operator=(inline_instream&& other)
+            noexcept(std::is_nothrow_move_constructible<_inbuf_type>::value)
+    {
+        if (this == &other) return *this;
+        _move_streambuf(this->_streambuf, other._streambuf, std::is_nothrow_move_constructible<_inbuf_type>{});
+        _istream_type::operator=(std::move(other));
+        _istream_type::set_rdbuf(&this->_streambuf);
+        other.rdbuf(nullptr);
+        return *this;
+    }
+
+    inline_instream(const inline_instream& ) = delete;
+    inline_instream& operator=(const inline_instream& ) = delete;
+
+    Source& operator*() { return *this->_streambuf; }
+    Source* operator->() { return this->_streambuf.operator->(); }
+
+    const Source& operator*() const { return *this->_streambuf; }
+    const Source* operator->() const { return this->_streambuf.operator->(); }
+
+    /**
+     * Provides the stream buffer with its own type, as
+     * <code>std::basic_fstream::rdbuf</code> does.
+     *
+     * @return pointer to the nova::basic_inbuf of the stream.
+     */
+    _inbuf_type* rdbuf() const { return static_cast<_inbuf_type*>(_istream_type::rdbuf()); }
+    using _istream_type::rdbuf;
+
+    /**
+     * @see instream::in_span
+     */
+    std::pair<const char_type*, std::size_t> in_span() { return this->_streambuf.in_span(); }
+    /**
+     * @see instream::consume
+     */
+    void consume(std::size_t n) { this->_streambuf.consume(n); }
+
+    /**
+     * Reuses the stream for another source without constructing a new
+     * stream object. The unread characters are discarded and the source is
+     * replaced with the one constructed from <code>args</code>. The buffer
+     * and the locale are kept; the stream state, formatting, exception
+     * mask and tied stream are reset to those of a new stream. If
+     * constructing the new <code>Source</code> throws, the stream is left
+     * with <code>badbit</code> set and the exception is propagated.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Source</code>
+     */
+    template <typename... Args>
+    void rebind(Args&&... args)
+    {
+        if (!_istream_type::rdbuf()) _istream_type::set_rdbuf(&this->_streambuf);
+        try
+        {
+            this->_streambuf.rebind(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            _reset_ios(*this);
+            this->setstate(std::ios_base::badbit);
+            throw;
+        }
+        _reset_ios(*this);
+    }
 };
 
 template <typename Source, typename Category = void>
@@ -812,7 +2631,14 @@ public:
     explicit device_source(Source& source) : _source{source} {}
     ~device_source() noexcept = default;
 
-    auto read(const char_type* s, std::streamsize n) { return _source.read(s, n); }
+    auto read(char_type* s, std::streamsize n) { return _source.read(s, n); }
+
+    template<typename D = Source>
+    auto seek(std::streamoff off, std::ios_base::seekdir dir)
+            -> decltype(std::declval<D&>().seek(off, dir, std::ios_base::in))
+    {
+        return _source.seek(off, dir, std::ios_base::in);
+    }
 
 private:
     Source& _source;
@@ -829,6 +2655,20 @@ public:
 
     auto get_in_buffer() { return _source.get_in_buffer(); };
 
+    template<typename D = Source>
+    auto release_in_buffer(const char_type* buf, std::size_t consumed)
+            -> decltype(std::declval<D&>().release_in_buffer(buf, consumed))
+    {
+        return _source.release_in_buffer(buf, consumed);
+    }
+
+    template<typename D = Source>
+    auto seek(std::streamoff off, std::ios_base::seekdir dir)
+            -> decltype(std::declval<D&>().seek(off, dir, std::ios_base::in))
+    {
+        return _source.seek(off, dir, std::ios_base::in);
+    }
+
 private:
     Source& _source;
 };
@@ -849,6 +2689,20 @@ public:
     auto write(const char_type* s, std::streamsize n) { return _sink.write(s, n); }
     auto flush() { return _sink.flush();}
 
+    template<typename D = Sink>
+    auto write_v(const std::pair<const char_type*, std::size_t>* spans, int count)
+            -> decltype(std::declval<D&>().write_v(spans, count))
+    {
+        return _sink.write_v(spans, count);
+    }
+
+    template<typename D = Sink>
+    auto seek(std::streamoff off, std::ios_base::seekdir dir)
+            -> decltype(std::declval<D&>().seek(off, dir, std::ios_base::out))
+    {
+        return _sink.seek(off, dir, std::ios_base::out);
+    }
+
 private:
     Sink& _sink;
 };
@@ -865,6 +2719,20 @@ public:
     auto get_out_buffer() { return _sink.get_out_buffer(); }
     auto flush(std::size_t size) { return _sink.flush(size);}
 
+    template<typename D = Sink>
+    auto release_out_buffer(char_type* buf, std::size_t written)
+            -> decltype(std::declval<D&>().release_out_buffer(buf, written))
+    {
+        return _sink.release_out_buffer(buf, written);
+    }
+
+    template<typename D = Sink>
+    auto seek(std::streamoff off, std::ios_base::seekdir dir)
+            -> decltype(std::declval<D&>().seek(off, dir, std::ios_base::out))
+    {
+        return _sink.seek(off, dir, std::ios_base::out);
+    }
+
 private:
     Sink& _sink;
 };
@@ -893,6 +2761,7 @@ private:
  *                   if <code>out_buffer_provider</code> is used as
  *                   <code>out_category</code>
  * @tparam Traits character traits type to be used in this stream.
+ * @tparam Allocator allocator for the stream buffer object and its buffer.
  *
  * @see sink
  * @see source
@@ -901,8 +2770,9 @@ private:
  * @see device_instream
  */
 template <typename Device, typename Buffering = non_buffered,
-          typename Traits = std::char_traits<typename Device::char_type>>
-using device_outstream = outstream<device_sink<Device>, Buffering, Traits>;
+          typename Traits = std::char_traits<typename Device::char_type>,
+          typename Allocator = std::allocator<typename Device::char_type>>
+using device_outstream = outstream<device_sink<Device>, Buffering, Traits, Allocator>;
 
 /**
  * Type definition for input stream which can accept <code>device</code>.
@@ -928,6 +2798,7 @@ using device_outstream = outstream<device_sink<Device>, Buffering, Traits>;
  *                   if <code>in_buffer_provider</code> is used as
  *                   <code>out_category</code>
  * @tparam Traits character traits type to be used in this stream.
+ * @tparam Allocator allocator for the stream buffer object and its buffer.
  *
  * @see sink
  * @see source
@@ -936,8 +2807,175 @@ using device_outstream = outstream<device_sink<Device>, Buffering, Traits>;
  * @see device_outstream
  */
 template <typename Device, typename Buffering = non_buffered,
-          typename Traits = std::char_traits<typename Device::char_type>>
-using device_instream = instream<device_source<Device>, Buffering, Traits>;
+          typename Traits = std::char_traits<typename Device::char_type>,
+          typename Allocator = std::allocator<typename Device::char_type>>
+using device_instream = instream<device_source<Device>, Buffering, Traits, Allocator>;
+
+template<typename Source, typename Sink>
+auto _can_transfer(int) -> decltype(transfer(std::declval<Source&>(), std::declval<Sink&>(), std::streamsize{}),
+                                    std::true_type{});
+template<typename Source, typename Sink>
+std::false_type _can_transfer(...);
+
+/* Copy loop of nova::copy, <code>in</code> and <code>out</code> are the
+ * streams or the stream buffers themselves. */
+template<typename In, typename Out, typename CharT, typename Traits>
+std::streamsize _copy_spans(In& in, Out& out, std::basic_streambuf<CharT, Traits>& inbuf,
+                            std::basic_streambuf<CharT, Traits>& outbuf, bool& eof)
+{
+    std::streamsize total = 0;
+    for (;;)
+    {
+        auto src = in.in_span();
+        if (!src.first)
+        {
+            eof = true;
+            break;
+        }
+        auto size = static_cast<std::streamsize>(src.second);
+        std::streamsize done;
+        if (size > 1)
+        {
+            /* The input buffer is written to the output buffer, or directly
+             * to the sink if it is large enough. */
+            done = outbuf.sputn(src.first, size);
+            in.consume(static_cast<std::size_t>(done));
+            total += done;
+            if (done < size) break;
+            continue;
+        }
+        /* Single characters come from unbuffered sources: let the source
+         * read into the output buffer instead. */
+        auto dst = out.out_span();
+        if (dst.first)
+        {
+            done = inbuf.sgetn(dst.first, static_cast<std::streamsize>(dst.second));
+            out.commit(static_cast<std::size_t>(done));
+            total += done;
+            continue;
+        }
+        /* Neither side has a buffer to work in (an unbuffered stream, or a
+         * single character left in the input buffer with an unbuffered
+         * output): copy through a local buffer, the only user space copy. */
+        CharT buf[4096 / sizeof(CharT)];
+        std::streamsize read = inbuf.sgetn(buf, static_cast<std::streamsize>(sizeof(buf) / sizeof(CharT)));
+        done = outbuf.sputn(buf, read);
+        total += done;
+        if (done < read) break;
+    }
+    return total;
+}
+
+template<typename In, typename Out, typename InBuf, typename OutBuf>
+std::streamsize _copy(In& in, Out& out, InBuf& inbuf, OutBuf& outbuf, bool& eof, std::false_type)
+{
+    return _copy_spans(in, out, inbuf, outbuf, eof);
+}
+
+template<typename In, typename Out, typename InBuf, typename OutBuf>
+std::streamsize _copy(In& in, Out& out, InBuf& inbuf, OutBuf& outbuf, bool& eof, std::true_type)
+{
+    std::streamsize total = 0;
+    /* Whatever is already buffered on either side goes first. */
+    while (inbuf.in_avail() > 0)
+    {
+        auto src = in.in_span();
+        auto size = static_cast<std::streamsize>(src.second);
+        std::streamsize done = outbuf.sputn(src.first, size);
+        in.consume(static_cast<std::size_t>(done));
+        total += done;
+        if (done < size) return total;
+    }
+    if (outbuf.pubsync() != 0) return total;
+    for (;;)
+    {
+        std::streamsize done = transfer(*in, *out, std::streamsize{1} << 30);
+        /* Not possible for these descriptors: copy in user space. */
+        if (done < 0) break;
+        if (done == 0)
+        {
+            eof = true;
+            return total;
+        }
+        /* The transfer moved the source and the sink, the stream positions follow. */
+        inbuf.transferred(done);
+        outbuf.transferred(done);
+        total += done;
+    }
+    return total + _copy_spans(in, out, inbuf, outbuf, eof);
+}
+
+/**
+ * Copies all characters from the input stream to the output stream.
+ *
+ * Works with any nova::instream and nova::outstream (or their inline
+ * versions). The characters are not copied through a temporary buffer:
+ * the input stream buffer (or the span of nova::in_buffer_provider) is
+ * written to the output stream buffer or directly to the sink, unbuffered
+ * sources read directly into the output buffer (or the span of
+ * nova::out_buffer_provider).
+ *
+ * If the <code>Source</code> and the <code>Sink</code> support copying
+ * between each other without user space (like nova::file_source and
+ * nova::file_sink from nova/fd_device.h on Linux) the data does not leave
+ * the kernel. Such pairs have a function found by argument dependent lookup
+ *
+ * ~~~~~{.cpp}
+ * std::streamsize transfer(Source& source, Sink& sink, std::streamsize n);
+ * ~~~~~
+ *
+ * copying up to <code>n</code> characters from the current position of
+ * <code>source</code> to the current position of <code>sink</code> and
+ * advancing both positions. It returns the number of characters copied, 0
+ * at the end of <code>source</code> or -1 if the copy is not possible, in
+ * which case the copy continues in user space.
+ *
+ * When the end of input is reached <code>eofbit</code> is set on
+ * <code>in</code>, if the output fails <code>badbit</code> is set on
+ * <code>out</code>.
+ *
+ * ~~~~~{.cpp}
+ * nova::instream<nova::file_source, nova::buffer_8k> in{"input.dat"};
+ * nova::outstream<nova::file_sink, nova::buffer_8k> out{"output.dat"};
+ * nova::copy(in, out);
+ * ~~~~~
+ *
+ * @param in input stream
+ * @param out output stream
+ * @return number of characters copied.
+ */
+template<typename IStream, typename OStream>
+auto copy(IStream& in, OStream& out)
+        -> decltype(in.in_span(), out.out_span(), in.rdbuf(), out.rdbuf(), std::streamsize{})
+{
+    typedef std::remove_reference_t<decltype(*in)>  source_type;
+    typedef std::remove_reference_t<decltype(*out)> sink_type;
+    if (!in || !out) return 0;
+    bool eof = false;
+    std::streamsize res = _copy(in, out, *in.rdbuf(), *out.rdbuf(), eof,
+                                decltype(_can_transfer<source_type, sink_type>(0)){});
+    if (eof) in.setstate(std::ios_base::eofbit);
+    else out.setstate(std::ios_base::badbit);
+    return res;
+}
+
+/**
+ * Copies all characters from the input stream buffer to the output stream
+ * buffer, the same way as nova::copy for the streams.
+ *
+ * @param in nova::basic_inbuf to read from
+ * @param out nova::basic_outbuf to write to
+ * @return number of characters copied.
+ */
+template<typename InBuf, typename OutBuf>
+auto copy(InBuf& in, OutBuf& out)
+        -> decltype(in.in_span(), out.out_span(), in.sgetn(nullptr, 0), out.sputn(nullptr, 0), std::streamsize{})
+{
+    typedef std::remove_reference_t<decltype(*in)>  source_type;
+    typedef std::remove_reference_t<decltype(*out)> sink_type;
+    bool eof = false;
+    return _copy(in, out, in, out, eof, decltype(_can_transfer<source_type, sink_type>(0)){});
+}
 
 } // end of nova namespace
 
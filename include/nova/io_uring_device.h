@@ -0,0 +1,856 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_IO_URING_DEVICE_H
+#define NOVA_IO_URING_DEVICE_H
+
+#include <nova/io.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/**
+ * @file io_uring_device.h
+ * @brief File device doing its I/O through Linux <code>io_uring</code>.
+ *
+ * The device talks to the kernel with the raw <code>io_uring</code> system
+ * calls, no liburing is needed. Reads are queued ahead into registered
+ * buffers and writes are submitted in batches, so most stream buffer
+ * switches and flushes do not enter the kernel at all. When
+ * <code>io_uring</code> is not available (old kernel, disabled by the
+ * administrator or seccomp, not a regular file) the device falls back to
+ * <code>pread</code> and <code>pwrite</code> with the same buffers.
+ *
+ * This header is Linux only.
+ */
+
+namespace nova {
+
+/**
+ * Tuning parameters of nova::basic_io_uring_device.
+ */
+struct uring_params
+{
+    /**
+     * Size of each buffer in bytes, rounded up to the page size.
+     */
+    std::size_t buffer_size = 128 * 1024;
+    /**
+     * Number of input buffers, i.e. reads kept queued ahead of the stream.
+     */
+    unsigned read_buffers = 4;
+    /**
+     * Number of output buffers. The stream waits for a write to complete
+     * only when all of them are in flight.
+     */
+    unsigned write_buffers = 4;
+    /**
+     * Number of queued requests which triggers a submission to the kernel.
+     * Requests are also submitted whenever the device has to wait for a
+     * completion, by <code>submit</code>, <code>drain</code> and
+     * <code>close</code>. Reads do not wait for a full batch: they are
+     * submitted as soon as fewer than half of <code>read_buffers</code>
+     * are being read by the kernel, to keep reading ahead of the stream.
+     */
+    unsigned submit_batch = 4;
+    /**
+     * Register the buffers with the kernel (fixed buffers). Falls back to
+     * regular buffers if the registration fails, e.g. due to
+     * <code>RLIMIT_MEMLOCK</code>.
+     */
+    bool register_buffers = true;
+    /**
+     * Use <code>io_uring</code> if available. If <code>false</code> the
+     * device always uses <code>pread</code> and <code>pwrite</code>.
+     */
+    bool use_uring = true;
+};
+
+/**
+ * File device for nova::device_instream and nova::device_outstream backed by
+ * <code>io_uring</code>.
+ *
+ * The device is nova::in_buffer_provider and nova::out_buffer_provider, the
+ * streams work directly in the device buffers. Reading starts at the
+ * beginning of the file and writing appends to its end (after optional
+ * truncation) with independent positions; open modes follow
+ * <code>std::fopen</code> like nova::basic_fd_device.
+ *
+ * Flushing the output stream queues the flushed data for writing; it is
+ * handed to the kernel with the next batch (see
+ * nova::uring_params::submit_batch), by <code>submit</code> or by
+ * <code>drain</code>, which also waits for all the writes to complete.
+ * <code>close</code> (called on destruction) drains.
+ *
+ * Errors are reported the same way as by the standard streams: the stream
+ * gets no more buffers. The <code>errno</code> value of the last failure is
+ * available from <code>error()</code>.
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_io_uring_device
+{
+public:
+    typedef CharT              char_type;
+    typedef in_buffer_provider in_category;
+    typedef out_buffer_provider out_category;
+
+    /**
+     * Opens the file.
+     *
+     * @param path file name
+     * @param mode combination of <code>std::ios_base::in</code>,
+     *             <code>out</code>, <code>app</code> and <code>trunc</code>
+     * @param params tuning parameters
+     */
+    explicit basic_io_uring_device(const std::string& path,
+                                   std::ios_base::openmode mode = std::ios_base::in,
+                                   const uring_params& params = uring_params{}) : _params{params}
+    {
+        bool readable = (mode & std::ios_base::in) != 0;
+        bool writable = (mode & std::ios_base::out) || (mode & std::ios_base::app);
+        bool truncate = (mode & std::ios_base::trunc) || (writable && !readable && !(mode & std::ios_base::app));
+        int flags = readable && writable ? O_RDWR : writable ? O_WRONLY : O_RDONLY;
+        if (writable) flags |= O_CREAT;
+        if (truncate) flags |= O_TRUNC;
+        flags |= O_CLOEXEC;
+        do _fd = ::open(path.c_str(), flags, 0644); while (_fd < 0 && errno == EINTR);
+        if (_fd < 0)
+        {
+            _error = errno;
+            return;
+        }
+        _owns_fd = true;
+        init(readable, writable);
+    }
+
+    /**
+     * Wraps already opened file descriptor.
+     *
+     * @param fd file descriptor
+     * @param owns_fd whether the descriptor is closed together with the device
+     * @param params tuning parameters
+     */
+    basic_io_uring_device(int fd, bool owns_fd, const uring_params& params = uring_params{}) :
+            _params{params}, _fd{fd}, _owns_fd{owns_fd}
+    {
+        int flags = ::fcntl(_fd, F_GETFL);
+        if (flags < 0)
+        {
+            _error = errno;
+            _fd = -1;
+            return;
+        }
+        int access = flags & O_ACCMODE;
+        init(access != O_WRONLY, access != O_RDONLY);
+    }
+
+    basic_io_uring_device(const basic_io_uring_device& ) = delete;
+    basic_io_uring_device& operator=(const basic_io_uring_device& ) = delete;
+
+    ~basic_io_uring_device() noexcept { close(); }
+
+    /**
+     * @return <code>true</code> if the descriptor is open.
+     */
+    bool is_open() const { return _fd >= 0; }
+    /**
+     * @return <code>true</code> if the I/O goes through <code>io_uring</code>,
+     *         <code>false</code> if <code>pread</code> and <code>pwrite</code>
+     *         are used.
+     */
+    bool uring() const { return _ring >= 0; }
+    /**
+     * @return <code>errno</code> of the last failed operation or 0.
+     */
+    int error() const { return _error; }
+    /**
+     * @return the underlying file descriptor.
+     */
+    int fd() const { return _fd; }
+    /**
+     * @return number of system calls made to transfer data so far.
+     */
+    std::size_t syscalls() const { return _syscalls; }
+
+    /**
+     * Hands the queued requests to the kernel without waiting for them.
+     */
+    void submit()
+    {
+        if (_ring >= 0 && _queued > 0) enter(_queued, 0, 0);
+    }
+
+    /**
+     * Submits the queued requests and waits until all of them complete.
+     */
+    void drain()
+    {
+        while (_active > 0 && wait()) {}
+    }
+
+    /**
+     * Writes pending output, waits for all requests and closes the
+     * descriptor if it is owned by the device.
+     */
+    void close() noexcept
+    {
+        if (_fd < 0) return;
+        if (_out_cur >= 0) queue_write(_out_filled);
+        drain();
+        if (_ring >= 0)
+        {
+            if (_sq_ptr) ::munmap(_sq_ptr, _sq_size);
+            if (_cq_ptr && _cq_ptr != _sq_ptr) ::munmap(_cq_ptr, _cq_size);
+            if (_sqes) ::munmap(_sqes, _sqes_size);
+            ::close(_ring);
+            _ring = -1;
+        }
+        if (_owns_fd) ::close(_fd);
+        _fd = -1;
+        if (_buffers) ::operator delete(_buffers, std::align_val_t{_page});
+        _buffers = nullptr;
+    }
+
+    /* in_buffer_provider function */
+    std::pair<const char_type*, std::size_t> get_in_buffer()
+    {
+        if (_fd < 0 || _in.empty()) return {nullptr, 0};
+        if (_ring < 0) return read_sync();
+        if (!_reading)
+        {
+            _reading = true;
+            for (std::size_t i = 0; i < _in.size(); ++i) queue_read((_in_next + i) % _in.size());
+        }
+        else if (_in_cur >= 0 && !_in_eof)
+        {
+            /* The stream is done with the previous buffer: it goes to the end of the queue. */
+            queue_read(static_cast<std::size_t>(_in_cur));
+        }
+        _in_cur = -1;
+        if (_in_eof) return {nullptr, 0};
+        submit_reads();
+        std::size_t index = _in_next;
+        in_slot& slot = _in[index];
+        if (slot.state == busy) reap();
+        while (slot.state == busy)
+        {
+            if (!wait()) return {nullptr, 0};
+        }
+        if (slot.state != done) return {nullptr, 0};
+        slot.state = idle;
+        if (slot.result <= 0)
+        {
+            if (slot.result < 0) _error = -slot.result;
+            _in_eof = true;
+            return {nullptr, 0};
+        }
+        auto got = static_cast<std::size_t>(slot.result);
+        got -= got % sizeof(char_type);
+        _in_pos = slot.offset + static_cast<off_t>(got);
+        _in_next = (index + 1) % _in.size();
+        _in_cur = static_cast<int>(index);
+        /* A short read is most likely the end of the file: the reads queued
+         * after it are restarted right after the data actually read. */
+        if (got < _buffer_size) restart_reads(_in_pos);
+        if (got == 0) return get_in_buffer();
+        return {reinterpret_cast<const char_type*>(slot.buf), got / sizeof(char_type)};
+    }
+
+    /* out_buffer_provider functions */
+    std::pair<char_type*, std::size_t> get_out_buffer()
+    {
+        if (_fd < 0 || _out.empty() || _failed) return {nullptr, 0};
+        /* The stream only asks for the next buffer when the previous one is full. */
+        if (_out_cur >= 0 && !queue_write(_buffer_size)) return {nullptr, 0};
+        std::size_t next = _out_cur < 0 ? 0 : (static_cast<std::size_t>(_out_cur) + 1) % _out.size();
+        if (_out[next].inflight > 0) reap();
+        while (_out[next].inflight > 0)
+        {
+            /* The output outpaces the device: collect several completions
+             * per system call. */
+            if (!wait(std::max<std::size_t>(_active / 2, 1))) return {nullptr, 0};
+        }
+        if (_failed) return {nullptr, 0};
+        _out_cur = static_cast<int>(next);
+        _out_filled = _out_sent = 0;
+        return {reinterpret_cast<char_type*>(_out[next].buf), _buffer_size / sizeof(char_type)};
+    }
+
+    void flush(std::size_t size)
+    {
+        if (_out_cur < 0) return;
+        _out_filled += size * sizeof(char_type);
+        queue_write(_out_filled);
+    }
+
+    /**
+     * Moves read or write position. The device keeps separate positions
+     * for reading and writing. Moving the read position waits for the reads
+     * queued ahead; output queued before the write position is moved is
+     * written at the old position.
+     *
+     * @param off offset in characters
+     * @param dir direction of the offset
+     * @param which <code>std::ios_base::in</code> or <code>std::ios_base::out</code>
+     * @return new position in characters or -1 if the descriptor is not seekable.
+     */
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+    {
+        if (_fd < 0 || !_seekable) return -1;
+        bool in = which & std::ios_base::in;
+        if (!in && _out_cur >= 0 && !queue_write(_out_filled)) return -1;
+        off_t base = 0;
+        if (dir == std::ios_base::cur) base = in ? _in_pos : _out_pos;
+        else if (dir == std::ios_base::end)
+        {
+            struct stat st{};
+            if (::fstat(_fd, &st) != 0)
+            {
+                _error = errno;
+                return -1;
+            }
+            base = std::max(st.st_size, _out_pos);
+        }
+        off_t target = base + static_cast<off_t>(off) * static_cast<off_t>(sizeof(char_type));
+        if (target < 0) return -1;
+        if (in)
+        {
+            /* The reads queued ahead are dropped, reading starts over at target. */
+            _in_cur = -1;
+            _reading = false;
+            restart_reads(target);
+            _in_next = 0;
+            _in_eof = false;
+            _in_pos = target;
+        }
+        else
+        {
+            /* The stream starts over with a new buffer. */
+            _out_cur = -1;
+            _out_pos = target;
+        }
+        return static_cast<std::streamoff>(target) / static_cast<std::streamoff>(sizeof(char_type));
+    }
+
+private:
+    enum slot_state { idle, busy, done };
+
+    struct in_slot
+    {
+        char* buf;
+        off_t offset;
+        int result;
+        slot_state state;
+    };
+
+    struct out_slot
+    {
+        char* buf;
+        unsigned inflight;
+    };
+
+    /* Request in flight. user_data of the submission is its index. */
+    struct op
+    {
+        char* ptr;
+        std::size_t len;
+        off_t offset;
+        std::size_t slot;
+        bool write;
+        iovec iov;
+    };
+
+    void init(bool readable, bool writable)
+    {
+        struct stat st{};
+        bool regular = ::fstat(_fd, &st) == 0 && S_ISREG(st.st_mode);
+        _seekable = ::lseek(_fd, 0, SEEK_CUR) >= 0;
+        if (_seekable)
+        {
+            _in_pos = 0;
+            _out_pos = ::lseek(_fd, 0, SEEK_END);
+        }
+        _page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        _buffer_size = std::max<std::size_t>((_params.buffer_size + _page - 1) / _page * _page, _page);
+        std::size_t reads = readable ? std::max(_params.read_buffers, 1u) : 0;
+        std::size_t writes = writable ? std::max(_params.write_buffers, 1u) : 0;
+        _params.submit_batch = std::max(_params.submit_batch, 1u);
+        if (_params.use_uring && regular) setup_ring(static_cast<unsigned>(2 * (reads + writes)));
+        /* Without the ring the buffers are used one at a time. */
+        if (_ring < 0)
+        {
+            reads = std::min<std::size_t>(reads, 1);
+            writes = std::min<std::size_t>(writes, 1);
+        }
+        if (reads + writes == 0) return;
+        _buffers = static_cast<char*>(::operator new(_buffer_size * (reads + writes), std::align_val_t{_page}));
+        for (std::size_t i = 0; i < reads; ++i) _in.push_back({_buffers + i * _buffer_size, 0, 0, idle});
+        for (std::size_t i = 0; i < writes; ++i) _out.push_back({_buffers + (reads + i) * _buffer_size, 0});
+        if (_ring >= 0 && _params.register_buffers)
+        {
+            std::vector<iovec> iovs(reads + writes);
+            for (std::size_t i = 0; i < iovs.size(); ++i) iovs[i] = {_buffers + i * _buffer_size, _buffer_size};
+            _fixed = ::syscall(__NR_io_uring_register, _ring, IORING_REGISTER_BUFFERS,
+                               iovs.data(), static_cast<unsigned>(iovs.size())) == 0;
+        }
+    }
+
+    void setup_ring(unsigned entries)
+    {
+        io_uring_params p{};
+        int ring = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(entries, 8u), &p));
+        if (ring < 0) return;
+        _sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        _cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+        if (single) _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+        _sq_ptr = map(ring, _sq_size, IORING_OFF_SQ_RING);
+        _cq_ptr = single ? _sq_ptr : map(ring, _cq_size, IORING_OFF_CQ_RING);
+        _sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+        _sqes = static_cast<io_uring_sqe*>(map(ring, _sqes_size, IORING_OFF_SQES));
+        if (!_sq_ptr || !_cq_ptr || !_sqes)
+        {
+            if (_sq_ptr) ::munmap(_sq_ptr, _sq_size);
+            if (_cq_ptr && _cq_ptr != _sq_ptr) ::munmap(_cq_ptr, _cq_size);
+            if (_sqes) ::munmap(_sqes, _sqes_size);
+            _sq_ptr = _cq_ptr = nullptr;
+            _sqes = nullptr;
+            ::close(ring);
+            return;
+        }
+        auto sq = static_cast<char*>(_sq_ptr);
+        auto cq = static_cast<char*>(_cq_ptr);
+        _sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        _sq_mask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        _sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        _cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        _cq_mask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        /* No more requests than submission entries are ever in flight, so
+         * the completion queue (twice as large) cannot overflow. */
+        _ops.resize(p.sq_entries);
+        for (std::size_t i = _ops.size(); i > 0; --i) _free_ops.push_back(i - 1);
+        _ring = ring;
+    }
+
+    static void* map(int ring, std::size_t size, off_t offset)
+    {
+        void* ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+
+    /* Ring indices shared with the kernel: our own ones are read plainly,
+     * the kernel's ones with acquire and ours published with release. */
+    void push(std::size_t index)
+    {
+        op& o = _ops[index];
+        unsigned tail = *_sq_tail;
+        unsigned pos = tail & _sq_mask;
+        io_uring_sqe& sqe = _sqes[pos];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.fd = _fd;
+        sqe.off = static_cast<__u64>(o.offset);
+        sqe.user_data = index;
+        if (_fixed)
+        {
+            sqe.opcode = o.write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe.addr = reinterpret_cast<__u64>(o.ptr);
+            sqe.len = static_cast<__u32>(o.len);
+            sqe.buf_index = static_cast<__u16>(o.write ? _in.size() + o.slot : o.slot);
+        }
+        else
+        {
+            sqe.opcode = o.write ? IORING_OP_WRITEV : IORING_OP_READV;
+            o.iov = {o.ptr, o.len};
+            sqe.addr = reinterpret_cast<__u64>(&o.iov);
+            sqe.len = 1;
+        }
+        _sq_array[pos] = pos;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++_queued;
+    }
+
+    bool enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        for (;;)
+        {
+            ++_syscalls;
+            long res = ::syscall(__NR_io_uring_enter, _ring, to_submit, min_complete, flags, nullptr, 0);
+            if (res >= 0)
+            {
+                _queued -= static_cast<unsigned>(res);
+                /* Requests are submitted in order, the reads may be among the rest. */
+                _reads_queued = std::min<std::size_t>(_reads_queued, _queued);
+                return true;
+            }
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EBUSY)
+            {
+                reap();
+                continue;
+            }
+            _error = errno;
+            _failed = true;
+            return false;
+        }
+    }
+
+    void maybe_submit()
+    {
+        if (_queued >= _params.submit_batch) submit();
+    }
+
+    /* Reads queued for the buffers the stream gave back go to the kernel
+     * right away once less than half of the buffers are being read, so
+     * that reading stays ahead of the stream. */
+    void submit_reads()
+    {
+        std::size_t low_water = std::max<std::size_t>(_in.size() / 2, 1);
+        if (_reads_queued > 0 && _reads_active - _reads_queued < low_water) submit();
+        else maybe_submit();
+    }
+
+    /* Submits everything queued and waits for at least count completions. */
+    bool wait(std::size_t count = 1)
+    {
+        if (_active == 0) return false;
+        if (!enter(_queued, static_cast<unsigned>(std::min(count, _active)), IORING_ENTER_GETEVENTS)) return false;
+        reap();
+        return true;
+    }
+
+    void reap()
+    {
+        unsigned head = *_cq_head;
+        unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe& cqe = _cqes[head & _cq_mask];
+            complete(static_cast<std::size_t>(cqe.user_data), cqe.res);
+        }
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    void complete(std::size_t index, int res)
+    {
+        op& o = _ops[index];
+        if (!o.write)
+        {
+            --_reads_active;
+            _in[o.slot].result = res;
+            _in[o.slot].state = done;
+            release_op(index);
+            return;
+        }
+        if (res == -EINTR || res == -EAGAIN)
+        {
+            push(index);
+            return;
+        }
+        if (res > 0 && static_cast<std::size_t>(res) < o.len)
+        {
+            /* Short write: the rest goes out with the same request. */
+            o.ptr += res;
+            o.len -= static_cast<std::size_t>(res);
+            o.offset += res;
+            push(index);
+            return;
+        }
+        if (res <= 0)
+        {
+            _error = res < 0 ? -res : EIO;
+            _failed = true;
+        }
+        --_out[o.slot].inflight;
+        release_op(index);
+    }
+
+    /* Returns _no_op if the ring failed. */
+    std::size_t acquire_op()
+    {
+        if (_free_ops.empty()) reap();
+        while (_free_ops.empty())
+        {
+            if (!wait()) return _no_op;
+        }
+        std::size_t index = _free_ops.back();
+        _free_ops.pop_back();
+        ++_active;
+        return index;
+    }
+
+    void release_op(std::size_t index)
+    {
+        _free_ops.push_back(index);
+        --_active;
+    }
+
+    void queue_read(std::size_t slot)
+    {
+        std::size_t index = acquire_op();
+        if (index == _no_op) return;
+        _ops[index] = {_in[slot].buf, _buffer_size, _read_off, slot, false, {}};
+        _in[slot].offset = _read_off;
+        _in[slot].state = busy;
+        _read_off += static_cast<off_t>(_buffer_size);
+        ++_reads_active;
+        ++_reads_queued;
+        push(index);
+    }
+
+    /* Waits for the reads in flight and queues them again from offset,
+     * starting with the slot after the one held by the stream. */
+    void restart_reads(off_t offset)
+    {
+        if (_ring < 0)
+        {
+            _read_off = offset;
+            return;
+        }
+        for (auto& slot : _in)
+        {
+            while (slot.state == busy && wait()) {}
+            slot.state = idle;
+        }
+        _read_off = offset;
+        if (!_reading) return;
+        for (std::size_t i = 0; i < _in.size(); ++i)
+        {
+            std::size_t slot = (_in_next + i) % _in.size();
+            if (static_cast<int>(slot) != _in_cur) queue_read(slot);
+        }
+        submit_reads();
+    }
+
+    /* Queues the current output buffer up to end (in bytes). */
+    bool queue_write(std::size_t end)
+    {
+        if (end <= _out_sent) return !_failed;
+        out_slot& slot = _out[static_cast<std::size_t>(_out_cur)];
+        char* ptr = slot.buf + _out_sent;
+        std::size_t len = end - _out_sent;
+        _out_sent = end;
+        if (_ring < 0) return write_sync(ptr, len);
+        std::size_t index = acquire_op();
+        if (index == _no_op) return false;
+        _ops[index] = {ptr, len, _out_pos, static_cast<std::size_t>(_out_cur), true, {}};
+        _out_pos += static_cast<off_t>(len);
+        ++slot.inflight;
+        push(index);
+        maybe_submit();
+        return !_failed;
+    }
+
+    std::pair<const char_type*, std::size_t> read_sync()
+    {
+        char* buf = _in[0].buf;
+        ssize_t res;
+        do
+        {
+            ++_syscalls;
+            res = _seekable ? ::pread(_fd, buf, _buffer_size, _read_off) : ::read(_fd, buf, _buffer_size);
+        }
+        while (res < 0 && errno == EINTR);
+        if (res <= 0)
+        {
+            if (res < 0) _error = errno;
+            return {nullptr, 0};
+        }
+        auto got = static_cast<std::size_t>(res);
+        got -= got % sizeof(char_type);
+        _read_off += static_cast<off_t>(got);
+        _in_pos = _read_off;
+        return {reinterpret_cast<const char_type*>(buf), got / sizeof(char_type)};
+    }
+
+    bool write_sync(const char* s, std::size_t n)
+    {
+        while (n > 0)
+        {
+            ++_syscalls;
+            ssize_t res = _seekable ? ::pwrite(_fd, s, n, _out_pos) : ::write(_fd, s, n);
+            if (res < 0 && errno == EINTR) continue;
+            if (res <= 0)
+            {
+                _error = res < 0 ? errno : EIO;
+                _failed = true;
+                return false;
+            }
+            s += res;
+            n -= static_cast<std::size_t>(res);
+            _out_pos += res;
+        }
+        return true;
+    }
+
+    static constexpr std::size_t _no_op = static_cast<std::size_t>(-1);
+
+    uring_params _params;
+    int _fd = -1;
+    bool _owns_fd = false;
+    bool _seekable = false;
+    bool _failed = false;
+    int _error = 0;
+    std::size_t _syscalls = 0;
+    std::size_t _page = 4096;
+    std::size_t _buffer_size = 0;
+    char* _buffers = nullptr;
+
+    /* Ring */
+    int _ring = -1;
+    bool _fixed = false;
+    void* _sq_ptr = nullptr;
+    void* _cq_ptr = nullptr;
+    std::size_t _sq_size = 0;
+    std::size_t _cq_size = 0;
+    std::size_t _sqes_size = 0;
+    io_uring_sqe* _sqes = nullptr;
+    unsigned* _sq_tail = nullptr;
+    unsigned* _sq_array = nullptr;
+    unsigned _sq_mask = 0;
+    unsigned* _cq_head = nullptr;
+    unsigned* _cq_tail = nullptr;
+    unsigned _cq_mask = 0;
+    io_uring_cqe* _cqes = nullptr;
+    std::vector<op> _ops;
+    std::vector<std::size_t> _free_ops;
+    /* Requests queued but not submitted yet and requests not completed yet. */
+    unsigned _queued = 0;
+    std::size_t _active = 0;
+    /* Reads not completed yet and those of them not submitted yet. */
+    std::size_t _reads_active = 0;
+    std::size_t _reads_queued = 0;
+
+    /* Input: slots are read in cyclic order, _in_next is the next one to
+     * hand to the stream, _in_cur the one the stream is reading. */
+    std::vector<in_slot> _in;
+    std::size_t _in_next = 0;
+    int _in_cur = -1;
+    bool _reading = false;
+    bool _in_eof = false;
+    off_t _read_off = 0;
+    off_t _in_pos = 0;
+
+    /* Output: the stream writes into _out_cur; _out_filled bytes of it are
+     * flushed, _out_sent of them queued. */
+    std::vector<out_slot> _out;
+    int _out_cur = -1;
+    std::size_t _out_filled = 0;
+    std::size_t _out_sent = 0;
+    off_t _out_pos = 0;
+};
+
+/**
+ * Source reading a file through <code>io_uring</code>: nova::basic_io_uring_device
+ * opened for reading which can be used directly with nova::instream.
+ *
+ * ~~~~~{.cpp}
+ * nova::instream<nova::io_uring_source> in{"data.log"};
+ * ~~~~~
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_io_uring_source : private basic_io_uring_device<CharT>
+{
+    typedef basic_io_uring_device<CharT> _device_type;
+public:
+    typedef CharT              char_type;
+    typedef in_buffer_provider category;
+
+    explicit basic_io_uring_source(const std::string& path, const uring_params& params = uring_params{}) :
+            _device_type{path, std::ios_base::in, params} {}
+    basic_io_uring_source(int fd, bool owns_fd, const uring_params& params = uring_params{}) :
+            _device_type{fd, owns_fd, params} {}
+
+    using _device_type::is_open;
+    using _device_type::uring;
+    using _device_type::error;
+    using _device_type::fd;
+    using _device_type::syscalls;
+    using _device_type::close;
+    using _device_type::get_in_buffer;
+
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir)
+    {
+        return _device_type::seek(off, dir, std::ios_base::in);
+    }
+};
+
+/**
+ * Sink writing a file through <code>io_uring</code>: nova::basic_io_uring_device
+ * opened for writing which can be used directly with nova::outstream.
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<nova::io_uring_sink> out{"data.log"};
+ * ~~~~~
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_io_uring_sink : private basic_io_uring_device<CharT>
+{
+    typedef basic_io_uring_device<CharT> _device_type;
+public:
+    typedef CharT               char_type;
+    typedef out_buffer_provider category;
+
+    explicit basic_io_uring_sink(const std::string& path,
+                                 std::ios_base::openmode mode = std::ios_base::out,
+                                 const uring_params& params = uring_params{}) :
+            _device_type{path, mode | std::ios_base::out, params} {}
+    basic_io_uring_sink(int fd, bool owns_fd, const uring_params& params = uring_params{}) :
+            _device_type{fd, owns_fd, params} {}
+
+    using _device_type::is_open;
+    using _device_type::uring;
+    using _device_type::error;
+    using _device_type::fd;
+    using _device_type::syscalls;
+    using _device_type::submit;
+    using _device_type::drain;
+    using _device_type::close;
+    using _device_type::get_out_buffer;
+    using _device_type::flush;
+
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir)
+    {
+        return _device_type::seek(off, dir, std::ios_base::out);
+    }
+};
+
+/**
+ * Type definition for <code>io_uring</code> device of <code>char</code>.
+ */
+typedef basic_io_uring_device<char> io_uring_device;
+/**
+ * Type definition for <code>io_uring</code> source of <code>char</code>.
+ */
+typedef basic_io_uring_source<char> io_uring_source;
+/**
+ * Type definition for <code>io_uring</code> sink of <code>char</code>.
+ */
+typedef basic_io_uring_sink<char>   io_uring_sink;
+
+} // end of nova namespace
+
+#endif // NOVA_IO_URING_DEVICE_H
@@ -0,0 +1,360 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_MMAP_DEVICE_H
+#define NOVA_MMAP_DEVICE_H
+
+#include <nova/io.h>
+
+#include <cerrno>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @file mmap_device.h
+ * @brief Memory mapped file device for nova::instream and nova::outstream.
+ *
+ * The device maps the file into memory and hands the mapping to the streams
+ * as nova::in_buffer_provider and nova::out_buffer_provider, so the data is
+ * never copied between the page cache and a stream buffer.
+ *
+ * This header is POSIX only.
+ */
+
+namespace nova {
+
+/**
+ * Access pattern hint passed to <code>madvise</code> for mapped windows.
+ */
+enum class mmap_advice
+{
+    normal,     /**< MADV_NORMAL */
+    sequential, /**< MADV_SEQUENTIAL */
+    random      /**< MADV_RANDOM */
+};
+
+/**
+ * Tuning parameters of nova::basic_mmap_device.
+ */
+struct mmap_params
+{
+    /**
+     * Size in bytes of the window mapped for reading at a time. Zero means
+     * that the whole file is mapped at once. Rounded up to the page size.
+     */
+    std::size_t window_size = 0;
+    /**
+     * Number of bytes the file grows by every time the output stream needs
+     * more space. Rounded up to the page size.
+     */
+    std::size_t grow_size = 1 << 20;
+    /**
+     * Access pattern hint for the mapped windows.
+     */
+    mmap_advice advice = mmap_advice::sequential;
+    /**
+     * Ask the kernel to back the mappings with huge pages
+     * (<code>MADV_HUGEPAGE</code>) where the file system supports it.
+     */
+    bool huge_pages = false;
+    /**
+     * Prefault the mapped windows (<code>MAP_POPULATE</code>).
+     */
+    bool populate = false;
+};
+
+/**
+ * Memory mapped file device.
+ *
+ * The device is nova::in_buffer_provider and nova::out_buffer_provider at
+ * the same time, so it can be shared between nova::device_instream and
+ * nova::device_outstream:
+ *
+ * ~~~~~{.cpp}
+ * nova::mmap_device device{"data.log", std::ios_base::in | std::ios_base::out};
+ * nova::device_outstream<nova::mmap_device> out{device};
+ * nova::device_instream<nova::mmap_device> in{device};
+ * ~~~~~
+ *
+ * Reading starts at the beginning of the file and returns the file either
+ * as one span or in windows of <code>mmap_params::window_size</code>
+ * bytes. Writing always appends to the end of the data: the file is grown
+ * with <code>ftruncate</code> by <code>mmap_params::grow_size</code> and
+ * the new region is mapped. When the device is closed the file is trimmed
+ * to the number of characters actually written.
+ *
+ * Open modes follow <code>std::fopen</code>: <code>out</code> without
+ * <code>in</code> or <code>app</code> truncates the file, <code>trunc</code>
+ * always does.
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_mmap_device
+{
+public:
+    typedef CharT              char_type;
+    typedef in_buffer_provider in_category;
+    typedef out_buffer_provider out_category;
+
+    /**
+     * Opens and maps the file.
+     *
+     * @param path file name
+     * @param mode combination of <code>std::ios_base::in</code>,
+     *             <code>out</code>, <code>app</code> and <code>trunc</code>
+     * @param params tuning parameters
+     */
+    explicit basic_mmap_device(const std::string& path,
+                               std::ios_base::openmode mode = std::ios_base::in,
+                               const mmap_params& params = mmap_params{}) :
+            _params{params}, _page{static_cast<std::size_t>(::sysconf(_SC_PAGESIZE))}
+    {
+        _params.window_size = round_up(_params.window_size);
+        _params.grow_size = round_up(_params.grow_size > 0 ? _params.grow_size : 1);
+        _writable = (mode & std::ios_base::out) || (mode & std::ios_base::app);
+        bool truncate = (mode & std::ios_base::trunc) ||
+                        (_writable && !(mode & std::ios_base::in) && !(mode & std::ios_base::app));
+        int flags = _writable ? O_RDWR | O_CREAT : O_RDONLY;
+        if (truncate) flags |= O_TRUNC;
+        do _fd = ::open(path.c_str(), flags | O_CLOEXEC, 0644); while (_fd < 0 && errno == EINTR);
+        if (_fd < 0) return;
+        struct stat st{};
+        if (::fstat(_fd, &st) != 0)
+        {
+            close();
+            return;
+        }
+        _size = static_cast<std::size_t>(st.st_size);
+        _file_size = _size;
+    }
+
+    basic_mmap_device(const basic_mmap_device& ) = delete;
+    basic_mmap_device& operator=(const basic_mmap_device& ) = delete;
+
+    ~basic_mmap_device() noexcept { close(); }
+
+    /**
+     * @return <code>true</code> if the file was opened successfully.
+     */
+    bool is_open() const { return _fd >= 0; }
+
+    /**
+     * @return number of characters in the file, including the ones
+     *         written through this device.
+     */
+    std::size_t size() const { return _size / sizeof(char_type); }
+
+    /**
+     * Unmaps the file, trims it to the written size and closes it.
+     */
+    void close() noexcept
+    {
+        if (_fd < 0) return;
+        unmap(_in_map, _in_map_size);
+        unmap(_out_map, _out_map_size);
+        if (_writable && _file_size != _size)
+        {
+            while (::ftruncate(_fd, static_cast<off_t>(_size)) != 0 && errno == EINTR) {}
+        }
+        ::close(_fd);
+        _fd = -1;
+    }
+
+    /* in_buffer_provider function */
+    std::pair<const char_type*, std::size_t> get_in_buffer()
+    {
+        unmap(_in_map, _in_map_size);
+        if (_fd < 0 || _in_pos >= _size) return {nullptr, 0};
+        std::size_t offset = _in_pos - _in_pos % _page;
+        std::size_t length = _size - offset;
+        if (_params.window_size > 0 && length > _params.window_size) length = _params.window_size;
+        void* map = map_region(offset, length, _writable ? PROT_READ | PROT_WRITE : PROT_READ);
+        if (!map) return {nullptr, 0};
+        _in_map = static_cast<char*>(map);
+        _in_map_size = length;
+        auto buf = reinterpret_cast<const char_type*>(_in_map + (_in_pos - offset));
+        std::size_t count = (offset + length - _in_pos) / sizeof(char_type);
+        _in_pos = offset + length;
+        return {buf, count};
+    }
+
+    /* out_buffer_provider functions */
+    std::pair<char_type*, std::size_t> get_out_buffer()
+    {
+        if (_fd < 0 || !_writable) return {nullptr, 0};
+        /* The stream only asks for the next buffer when the previous one is full. */
+        if (_out_map) _size = _out_end;
+        unmap(_out_map, _out_map_size);
+        std::size_t new_end = _size + _params.grow_size;
+        if (new_end > _file_size)
+        {
+            int res;
+            while ((res = ::ftruncate(_fd, static_cast<off_t>(new_end))) != 0 && errno == EINTR) {}
+            if (res != 0) return {nullptr, 0};
+            _file_size = new_end;
+        }
+        std::size_t offset = _size - _size % _page;
+        void* map = map_region(offset, new_end - offset, PROT_READ | PROT_WRITE);
+        if (!map) return {nullptr, 0};
+        _out_map = static_cast<char*>(map);
+        _out_map_size = new_end - offset;
+        _out_end = new_end;
+        return {reinterpret_cast<char_type*>(_out_map + (_size - offset)), _params.grow_size / sizeof(char_type)};
+    }
+
+    void flush(std::size_t size) { _size += size * sizeof(char_type); }
+
+    /**
+     * Moves read position. Writing always appends, so only
+     * <code>std::ios_base::in</code> is supported.
+     *
+     * @param off offset in characters
+     * @param dir direction of the offset
+     * @param which must be <code>std::ios_base::in</code>
+     * @return new position in characters or -1 on failure.
+     */
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+    {
+        if (_fd < 0 || !(which & std::ios_base::in) || (which & std::ios_base::out)) return -1;
+        std::streamoff base = 0;
+        if (dir == std::ios_base::cur) base = static_cast<std::streamoff>(_in_pos);
+        else if (dir == std::ios_base::end) base = static_cast<std::streamoff>(_size);
+        std::streamoff target = base + off * static_cast<std::streamoff>(sizeof(char_type));
+        if (target < 0 || target > static_cast<std::streamoff>(_size)) return -1;
+        unmap(_in_map, _in_map_size);
+        _in_pos = static_cast<std::size_t>(target);
+        return target / static_cast<std::streamoff>(sizeof(char_type));
+    }
+
+private:
+    std::size_t round_up(std::size_t size) const { return (size + _page - 1) / _page * _page; }
+
+    void* map_region(std::size_t offset, std::size_t length, int prot)
+    {
+        int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        if (_params.populate) flags |= MAP_POPULATE;
+#endif
+        void* map = ::mmap(nullptr, length, prot, flags, _fd, static_cast<off_t>(offset));
+        if (map == MAP_FAILED) return nullptr;
+        switch (_params.advice)
+        {
+            case mmap_advice::sequential: ::madvise(map, length, MADV_SEQUENTIAL); break;
+            case mmap_advice::random:     ::madvise(map, length, MADV_RANDOM); break;
+            default: break;
+        }
+#ifdef MADV_HUGEPAGE
+        if (_params.huge_pages) ::madvise(map, length, MADV_HUGEPAGE);
+#endif
+        return map;
+    }
+
+    static void unmap(char*& map, std::size_t& size) noexcept
+    {
+        if (map) ::munmap(map, size);
+        map = nullptr;
+        size = 0;
+    }
+
+    mmap_params _params;
+    std::size_t _page;
+    int _fd = -1;
+    bool _writable = false;
+    /* All positions and sizes are in bytes. */
+    std::size_t _size = 0;
+    std::size_t _file_size = 0;
+    std::size_t _in_pos = 0;
+    char* _in_map = nullptr;
+    std::size_t _in_map_size = 0;
+    char* _out_map = nullptr;
+    std::size_t _out_map_size = 0;
+    std::size_t _out_end = 0;
+};
+
+/**
+ * Memory mapped file source: nova::basic_mmap_device opened for reading
+ * which can be used directly with nova::instream.
+ *
+ * ~~~~~{.cpp}
+ * nova::instream<nova::mmap_source> in{"data.log"};
+ * ~~~~~
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_mmap_source : private basic_mmap_device<CharT>
+{
+    typedef basic_mmap_device<CharT> _device_type;
+public:
+    typedef CharT              char_type;
+    typedef in_buffer_provider category;
+
+    explicit basic_mmap_source(const std::string& path, const mmap_params& params = mmap_params{}) :
+            _device_type{path, std::ios_base::in, params} {}
+
+    using _device_type::is_open;
+    using _device_type::size;
+    using _device_type::close;
+    using _device_type::get_in_buffer;
+
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir)
+    {
+        return _device_type::seek(off, dir, std::ios_base::in);
+    }
+};
+
+/**
+ * Memory mapped file sink: nova::basic_mmap_device opened for writing
+ * which can be used directly with nova::outstream.
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<nova::mmap_sink> out{"data.log"};
+ * ~~~~~
+ *
+ * @tparam CharT character type
+ */
+template<typename CharT>
+class basic_mmap_sink : private basic_mmap_device<CharT>
+{
+    typedef basic_mmap_device<CharT> _device_type;
+public:
+    typedef CharT               char_type;
+    typedef out_buffer_provider category;
+
+    explicit basic_mmap_sink(const std::string& path,
+                             std::ios_base::openmode mode = std::ios_base::out,
+                             const mmap_params& params = mmap_params{}) :
+            _device_type{path, mode | std::ios_base::out, params} {}
+
+    using _device_type::is_open;
+    using _device_type::size;
+    using _device_type::close;
+    using _device_type::get_out_buffer;
+    using _device_type::flush;
+};
+
+/**
+ * Type definition for memory mapped file device of <code>char</code>.
+ */
+typedef basic_mmap_device<char> mmap_device;
+/**
+ * Type definition for memory mapped file source of <code>char</code>.
+ */
+typedef basic_mmap_source<char> mmap_source;
+/**
+ * Type definition for memory mapped file sink of <code>char</code>.
+ */
+typedef basic_mmap_sink<char>   mmap_sink;
+
+} // end of nova namespace
+
+#endif // NOVA_MMAP_DEVICE_H
@@ -0,0 +1,273 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_RING_DEVICE_H
+#define NOVA_RING_DEVICE_H
+
+#include <nova/io.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * @file ring_device.h
+ * @brief Bounded in-process pipe between an output stream in one thread and
+ * an input stream in another.
+ *
+ * ~~~~~{.cpp}
+ * nova::ring_device ring{64 * 1024};
+ * std::thread producer{[&ring]
+ * {
+ *     nova::device_outstream<nova::ring_device> out{ring};
+ *     out << "data";
+ *     out.flush();
+ *     ring.close();
+ * }};
+ * nova::device_instream<nova::ring_device> in{ring};
+ * std::string data;
+ * in >> data;
+ * producer.join();
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Wait policy of nova::basic_ring_device which spins (yielding the
+ * processor) until the other side makes progress. Lowest latency, but a
+ * waiting thread keeps its core busy.
+ */
+class spin_wait
+{
+public:
+    template<typename Pred>
+    void wait(Pred pred)
+    {
+        while (!pred()) std::this_thread::yield();
+    }
+
+    void notify() noexcept { }
+};
+
+/**
+ * Wait policy of nova::basic_ring_device which spins briefly and then
+ * sleeps on a condition variable. The side making progress only takes the
+ * mutex when the other one sleeps.
+ */
+class blocking_wait
+{
+public:
+    /**
+     * Number of checks before going to sleep.
+     */
+    static constexpr int spins = 64;
+
+    template<typename Pred>
+    void wait(Pred pred)
+    {
+        for (int i = 0; i < spins; ++i)
+        {
+            if (pred()) return;
+        }
+        /* Pairs with notify: either the waker sees the sleeper or the
+         * sleeper sees the progress. */
+        _sleeping.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _cond.wait(lock, pred);
+        }
+        _sleeping.fetch_sub(1);
+    }
+
+    void notify()
+    {
+        if (_sleeping.load() == 0) return;
+        std::lock_guard<std::mutex> lock{_mutex};
+        _cond.notify_all();
+    }
+
+private:
+    std::atomic<int> _sleeping{0};
+    std::mutex _mutex;
+    std::condition_variable _cond;
+};
+
+/**
+ * Fixed capacity ring buffer shared by exactly one writing thread and one
+ * reading thread without locks.
+ *
+ * The device is nova::out_buffer_provider and nova::in_buffer_provider at
+ * the same time, to be used with nova::device_outstream in the producing
+ * thread and nova::device_instream in the consuming one. The streams
+ * format and parse directly in the ring: <code>get_out_buffer</code>
+ * hands out the contiguous free space and <code>get_in_buffer</code> the
+ * contiguous readable data, so nothing is copied in between. Characters
+ * become readable when the output stream fills its span or is flushed.
+ * Data a destroyed input stream did not read stays in the ring for the
+ * next one.
+ *
+ * When the ring is full the writer waits for the reader and when it is
+ * empty the reader waits for the writer, as decided by the
+ * <code>Wait</code> policy. <code>close</code> ends the transfer: the
+ * reader gets the rest of the data and then the end of stream; the writer
+ * gets no more space.
+ *
+ * @tparam CharT character type
+ * @tparam Wait wait policy, nova::blocking_wait or nova::spin_wait
+ */
+template<typename CharT, typename Wait = blocking_wait>
+class basic_ring_device
+{
+public:
+    typedef CharT               char_type;
+    typedef in_buffer_provider  in_category;
+    typedef out_buffer_provider out_category;
+
+    /**
+     * @param capacity capacity of the ring in characters
+     */
+    explicit basic_ring_device(std::size_t capacity) :
+            _capacity{capacity > 0 ? capacity : 1}, _buffer{new char_type[_capacity]} {}
+
+    basic_ring_device(const basic_ring_device& ) = delete;
+    basic_ring_device& operator=(const basic_ring_device& ) = delete;
+
+    /* out_buffer_provider functions, called by the writing thread */
+    std::pair<char_type*, std::size_t> get_out_buffer()
+    {
+        /* The stream only asks for the next span when the previous one is full. */
+        publish(_out_begin + _out_size);
+        std::size_t write_pos = _out_begin + _out_size;
+        _out_size = 0;
+        _out_flushed = 0;
+        _out_begin = write_pos;
+        std::size_t read_pos = 0;
+        _not_full.wait([&]
+        {
+            read_pos = _read_pos.load();
+            return write_pos - read_pos < _capacity || _closed.load();
+        });
+        if (_closed.load()) return {nullptr, 0};
+        std::size_t offset = write_pos % _capacity;
+        _out_size = std::min(_capacity - (write_pos - read_pos), _capacity - offset);
+        return {_buffer.get() + offset, _out_size};
+    }
+
+    void flush(std::size_t size)
+    {
+        _out_flushed += size;
+        publish(_out_begin + _out_flushed);
+    }
+
+    void release_out_buffer(char_type* , std::size_t written)
+    {
+        /* The unused rest of the span goes back to the ring. */
+        _out_begin += written;
+        _out_size = 0;
+        _out_flushed = 0;
+        publish(_out_begin);
+    }
+
+    /* in_buffer_provider functions, called by the reading thread */
+    std::pair<const char_type*, std::size_t> get_in_buffer()
+    {
+        /* The stream only asks for the next span when the previous one is read. */
+        std::size_t read_pos = _in_begin + _in_size;
+        _in_size = 0;
+        _in_begin = read_pos;
+        _read_pos.store(read_pos);
+        _not_full.notify();
+        std::size_t write_pos = 0;
+        _not_empty.wait([&]
+        {
+            write_pos = _write_pos.load();
+            return write_pos != read_pos || _closed.load();
+        });
+        /* Closing does not discard what was written before. */
+        write_pos = _write_pos.load();
+        if (write_pos == read_pos) return {nullptr, 0};
+        std::size_t offset = read_pos % _capacity;
+        _in_size = std::min(write_pos - read_pos, _capacity - offset);
+        return {_buffer.get() + offset, _in_size};
+    }
+
+    void release_in_buffer(const char_type* , std::size_t consumed)
+    {
+        /* The unread rest of the span stays for the next get_in_buffer. */
+        _in_begin += consumed;
+        _in_size = 0;
+        _read_pos.store(_in_begin);
+        _not_full.notify();
+    }
+
+    /**
+     * Ends the transfer. Called by the writer when it is done (after
+     * flushing its stream) or by the reader to abandon the data.
+     */
+    void close()
+    {
+        _closed.store(true);
+        _not_empty.notify();
+        _not_full.notify();
+    }
+
+    /**
+     * @return <code>true</code> if <code>close</code> was called.
+     */
+    bool is_closed() const { return _closed.load(); }
+
+    /**
+     * @return capacity of the ring in characters.
+     */
+    std::size_t capacity() const { return _capacity; }
+
+    /**
+     * @return number of characters written and not yet handed to the reader.
+     *         Approximate while the other thread is running.
+     */
+    std::size_t size() const { return _write_pos.load() - _read_pos.load(); }
+
+private:
+    void publish(std::size_t write_pos)
+    {
+        if (write_pos == _write_pos.load(std::memory_order_relaxed)) return;
+        _write_pos.store(write_pos);
+        _not_empty.notify();
+    }
+
+    const std::size_t _capacity;
+    std::unique_ptr<char_type[]> _buffer;
+    std::atomic<bool> _closed{false};
+
+    /* Positions are character counts since the start, the offset in the
+     * ring is the position modulo the capacity. */
+    alignas(64) std::atomic<std::size_t> _write_pos{0};
+    /* Writer only: the span handed out last. */
+    std::size_t _out_begin = 0;
+    std::size_t _out_size = 0;
+    std::size_t _out_flushed = 0;
+    Wait _not_empty;
+
+    alignas(64) std::atomic<std::size_t> _read_pos{0};
+    /* Reader only: the span handed out last. */
+    std::size_t _in_begin = 0;
+    std::size_t _in_size = 0;
+    Wait _not_full;
+};
+
+/**
+ * Type definition for ring device of <code>char</code> with blocking waits.
+ */
+typedef basic_ring_device<char> ring_device;
+
+} // end of nova namespace
+
+#endif // NOVA_RING_DEVICE_H
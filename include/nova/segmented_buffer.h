@@ -0,0 +1,287 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_SEGMENTED_BUFFER_H
+#define NOVA_SEGMENTED_BUFFER_H
+
+#include <nova/io.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#define NOVA_HAS_IOVEC 1
+#endif
+
+/**
+ * @file segmented_buffer.h
+ * @brief Memory sink made of fixed size segments and its read back source.
+ *
+ * ~~~~~{.cpp}
+ * nova::outstream<nova::segmented_buffer_sink> out;
+ * out << "large response";
+ * out.flush();
+ * auto iov = out->iovecs();
+ * ::writev(fd, iov.data(), static_cast<int>(iov.size()));
+ *
+ * nova::instream<nova::segmented_buffer_source> in{*out};
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Output buffer provider keeping the written characters in memory as a
+ * chain of fixed size segments.
+ *
+ * Unlike a growing contiguous buffer it never reallocates: when a segment
+ * is full the next one is allocated and the data written so far stays
+ * where it is. The content is available as a list of segments (or
+ * <code>iovec</code>s for <code>writev</code>) and can be read back without
+ * copying through nova::basic_segmented_buffer_source. One contiguous
+ * buffer is only built on explicit <code>coalesce</code>.
+ *
+ * Segments are allocated with <code>Allocator</code>; with
+ * nova::pool_allocator they are recycled through nova::buffer_pool.
+ *
+ * The content seen by the accessors is what the stream has flushed.
+ *
+ * @tparam CharT character type
+ * @tparam Allocator allocator of the segments
+ */
+template<typename CharT, typename Allocator = std::allocator<CharT>>
+class basic_segmented_buffer_sink
+{
+    typedef std::allocator_traits<Allocator> _alloc_traits;
+public:
+    typedef CharT                         char_type;
+    typedef std::basic_string_view<CharT> string_view_type;
+    typedef out_buffer_provider           category;
+
+    /**
+     * Default size of a segment in characters.
+     */
+    static constexpr std::size_t default_segment_size = 16 * 1024;
+
+    /**
+     * Constructor.
+     *
+     * @param segment_size size of each segment in characters
+     * @param alloc allocator of the segments
+     */
+    explicit basic_segmented_buffer_sink(std::size_t segment_size = default_segment_size,
+                                         const Allocator& alloc = Allocator{}) :
+            _alloc{alloc}, _segment_size{segment_size > 0 ? segment_size : 1} {}
+
+    basic_segmented_buffer_sink(const basic_segmented_buffer_sink& ) = delete;
+    basic_segmented_buffer_sink& operator=(const basic_segmented_buffer_sink& ) = delete;
+
+    ~basic_segmented_buffer_sink() noexcept { clear(); }
+
+    /* out_buffer_provider functions */
+    std::pair<char_type*, std::size_t> get_out_buffer()
+    {
+        /* The stream only asks for the next buffer when the previous one is full. */
+        if (!_segments.empty()) _size = _full_size += _segments.back().capacity;
+        char_type* data = _alloc_traits::allocate(_alloc, _segment_size);
+        _segments.push_back({data, _segment_size});
+        return {data, _segment_size};
+    }
+
+    void flush(std::size_t size) { _size += size; }
+
+    /**
+     * @return number of characters written.
+     */
+    std::size_t size() const { return _size; }
+    /**
+     * @return <code>true</code> if nothing is written.
+     */
+    bool empty() const { return _size == 0; }
+    /**
+     * @return size of newly allocated segments.
+     */
+    std::size_t segment_size() const { return _segment_size; }
+
+    /**
+     * @return number of segments.
+     */
+    std::size_t segment_count() const { return _segments.size(); }
+
+    /**
+     * @param i index of the segment, less than <code>segment_count</code>
+     * @return content of the segment.
+     */
+    string_view_type segment(std::size_t i) const
+    {
+        return {_segments[i].data, i + 1 < _segments.size() ? _segments[i].capacity : _size - _full_size};
+    }
+
+    /**
+     * @return content of all the segments in order.
+     */
+    std::vector<string_view_type> segments() const
+    {
+        std::vector<string_view_type> res;
+        res.reserve(_segments.size());
+        for (std::size_t i = 0; i < _segments.size(); ++i) res.push_back(segment(i));
+        return res;
+    }
+
+#ifdef NOVA_HAS_IOVEC
+    /**
+     * Content of all the segments for vectored writes. Note that
+     * <code>writev</code> accepts at most <code>IOV_MAX</code> entries.
+     *
+     * @return <code>iovec</code> for each segment in order.
+     */
+    std::vector<iovec> iovecs() const
+    {
+        std::vector<iovec> res;
+        res.reserve(_segments.size());
+        for (std::size_t i = 0; i < _segments.size(); ++i)
+        {
+            string_view_type seg = segment(i);
+            res.push_back({const_cast<char_type*>(seg.data()), seg.size() * sizeof(char_type)});
+        }
+        return res;
+    }
+#endif
+
+    /**
+     * Moves the content into a single segment unless it already is in one.
+     * This invalidates the buffer of the stream writing into the sink: it
+     * is meant to be called when the writing is done.
+     *
+     * @return the whole content.
+     */
+    string_view_type coalesce()
+    {
+        if (_segments.size() > 1)
+        {
+            char_type* data = _alloc_traits::allocate(_alloc, _size);
+            std::size_t pos = 0;
+            for (std::size_t i = 0; i < _segments.size(); ++i)
+            {
+                string_view_type seg = segment(i);
+                std::char_traits<char_type>::copy(data + pos, seg.data(), seg.size());
+                pos += seg.size();
+            }
+            std::size_t size = _size;
+            clear();
+            _segments.push_back({data, size});
+            _size = size;
+        }
+        return _segments.empty() ? string_view_type{} : segment(0);
+    }
+
+    /**
+     * Frees all the segments. Like <code>coalesce</code> it invalidates the
+     * buffer of the stream writing into the sink.
+     */
+    void clear() noexcept
+    {
+        for (auto& seg : _segments) _alloc_traits::deallocate(_alloc, seg.data, seg.capacity);
+        _segments.clear();
+        _size = 0;
+        _full_size = 0;
+    }
+
+private:
+    struct segment_block
+    {
+        char_type* data;
+        std::size_t capacity;
+    };
+
+    Allocator _alloc;
+    std::size_t _segment_size;
+    std::vector<segment_block> _segments;
+    /* Characters in all segments but the last one. */
+    std::size_t _full_size = 0;
+    std::size_t _size = 0;
+};
+
+/**
+ * Input buffer provider reading the content of
+ * nova::basic_segmented_buffer_sink segment by segment without copying.
+ *
+ * The source reads the content flushed to the sink at the time each
+ * segment is reached; the sink must outlive the source. The source is
+ * seekable.
+ *
+ * @tparam CharT character type
+ * @tparam Allocator allocator of the sink's segments
+ */
+template<typename CharT, typename Allocator = std::allocator<CharT>>
+class basic_segmented_buffer_source
+{
+public:
+    typedef CharT              char_type;
+    typedef in_buffer_provider category;
+
+    /**
+     * @param sink the sink to read
+     */
+    explicit basic_segmented_buffer_source(const basic_segmented_buffer_sink<CharT, Allocator>& sink) : _sink{sink} {}
+
+    /* in_buffer_provider function */
+    std::pair<const char_type*, std::size_t> get_in_buffer()
+    {
+        while (_index < _sink.segment_count())
+        {
+            auto seg = _sink.segment(_index);
+            std::size_t offset = _offset;
+            if (offset >= seg.size()) break;
+            /* The last segment may still grow: stay on it until it is full. */
+            if (_index + 1 < _sink.segment_count() || seg.size() == _sink.segment_size())
+            {
+                ++_index;
+                _offset = 0;
+            }
+            else _offset = seg.size();
+            return {seg.data() + offset, seg.size() - offset};
+        }
+        return {nullptr, 0};
+    }
+
+    /* seekable function */
+    std::streamoff seek(std::streamoff off, std::ios_base::seekdir dir)
+    {
+        if (dir == std::ios_base::end) off += static_cast<std::streamoff>(_sink.size());
+        if (off < 0 || off > static_cast<std::streamoff>(_sink.size())) return -1;
+        auto rest = static_cast<std::size_t>(off);
+        _index = 0;
+        while (_index + 1 < _sink.segment_count() && rest >= _sink.segment(_index).size())
+        {
+            rest -= _sink.segment(_index).size();
+            ++_index;
+        }
+        _offset = rest;
+        return off;
+    }
+
+private:
+    const basic_segmented_buffer_sink<CharT, Allocator>& _sink;
+    std::size_t _index = 0;
+    std::size_t _offset = 0;
+};
+
+/**
+ * Type definition for segmented buffer sink of <code>char</code>.
+ */
+typedef basic_segmented_buffer_sink<char> segmented_buffer_sink;
+/**
+ * Type definition for segmented buffer source of <code>char</code>.
+ */
+typedef basic_segmented_buffer_source<char> segmented_buffer_source;
+
+} // end of nova namespace
+
+#endif // NOVA_SEGMENTED_BUFFER_H
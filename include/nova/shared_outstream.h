@@ -0,0 +1,561 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_SHARED_OUTSTREAM_H
+#define NOVA_SHARED_OUTSTREAM_H
+
+#include <nova/io.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file shared_outstream.h
+ * @brief Output stream shared between threads without locking.
+ *
+ * ~~~~~{.cpp}
+ * nova::shared_outstream<nova::file_sink> log{"app.log"};
+ * // in any thread
+ * log.record() << "worker " << id << " done in " << ms << "ms\n";
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Parameters of nova::shared_outstream.
+ */
+struct shared_params
+{
+    /**
+     * Size of the per-thread buffer chunks in characters. Records are
+     * formatted into them; larger records get larger chunks.
+     */
+    std::size_t chunk_size = 16 * 1024;
+    /**
+     * Number of chunks a thread may have waiting for the writer thread. When
+     * all of them are in flight the thread waits for the writer.
+     */
+    std::size_t chunks = 8;
+    /**
+     * Size of the buffer in which the writer thread collects records before
+     * writing them to the sink.
+     */
+    std::size_t batch_size = 64 * 1024;
+};
+
+/**
+ * Output stream which can be written to from many threads at once.
+ *
+ * Every thread formats its records into its own buffer with its own
+ * nova::outstream. A finished record is published to the dedicated writer
+ * thread through a lock-free multi-producer queue; the writer collects the
+ * records into batches and writes them to <code>Sink</code>. Threads do not
+ * wait for each other or for the sink (unless all their buffer chunks are in
+ * flight, see nova::shared_params), and records never interleave: each one
+ * is written as a whole.
+ *
+ * A record is written with the nova::shared_outstream::record_stream
+ * returned by <code>record</code>; it is published when that object is
+ * destroyed, usually at the end of the full expression. A thread may have
+ * only one record open at a time. Format flags of the thread's stream are
+ * kept between records, the error state is cleared for every record.
+ *
+ * The sink is flushed whenever the writer thread runs out of records.
+ * <code>drain</code> waits until everything published so far is written;
+ * <code>close</code> (called on destruction) drains and stops the writer
+ * thread. All threads must finish their records before that.
+ *
+ * If <code>Sink</code> fails to write, the rest of the records are
+ * discarded and <code>good</code> returns <code>false</code>.
+ *
+ * @tparam Sink sink to write to, nova::sink
+ */
+template<typename Sink>
+class shared_outstream
+{
+    static_assert(std::is_same<typename Sink::category, nova::sink>::value, "shared_outstream requires nova::sink");
+
+    struct producer;
+public:
+    typedef typename Sink::char_type                   char_type;
+    typedef std::char_traits<char_type>                traits_type;
+    typedef std::basic_ostream<char_type, traits_type> ostream_type;
+
+    /**
+     * Single record being written by the calling thread. The record is
+     * published when this object is destroyed.
+     */
+    class record_stream
+    {
+    public:
+        record_stream(record_stream&& other) noexcept : _producer{other._producer} { other._producer = nullptr; }
+        record_stream(const record_stream& ) = delete;
+        record_stream& operator=(const record_stream& ) = delete;
+        record_stream& operator=(record_stream&& ) = delete;
+
+        ~record_stream() noexcept { if (_producer) _producer->end(); }
+
+        template<typename T>
+        record_stream& operator<<(const T& value)
+        {
+            _producer->out << value;
+            return *this;
+        }
+        record_stream& operator<<(std::ios_base& (*manip)(std::ios_base&))
+        {
+            manip(_producer->out);
+            return *this;
+        }
+        record_stream& operator<<(ostream_type& (*manip)(ostream_type&))
+        {
+            manip(_producer->out);
+            return *this;
+        }
+
+        /**
+         * @return the calling thread's stream the record is written to.
+         */
+        ostream_type& stream() { return _producer->out; }
+
+    private:
+        friend class shared_outstream;
+
+        explicit record_stream(producer& p) : _producer{&p} { p.begin(); }
+
+        producer* _producer;
+    };
+
+    /**
+     * Constructs the sink and starts the writer thread. Threads get their
+     * buffers on their first <code>record</code>.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template<typename... Args>
+    explicit shared_outstream(Args&&... args) :
+            _sink{std::forward<Args>(args)...}, _params{checked(shared_params{})}, _writer{[this] { run(); }} {}
+
+    /**
+     * Constructs the sink and starts the writer thread, with the sizes of
+     * the per-thread chunks and of the writer's batches given.
+     *
+     * @param params chunk and batch sizes; too small values are raised to
+     *               the least workable ones
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     */
+    template<typename... Args>
+    explicit shared_outstream(shared_params params, Args&&... args) :
+            _sink{std::forward<Args>(args)...}, _params{checked(params)}, _writer{[this] { run(); }} {}
+
+    shared_outstream(const shared_outstream& ) = delete;
+    shared_outstream& operator=(const shared_outstream& ) = delete;
+
+    ~shared_outstream() noexcept { close(); }
+
+    /**
+     * Starts a new record of the calling thread.
+     *
+     * @return stream for the record, publishing it on destruction.
+     */
+    record_stream record() { return record_stream{local()}; }
+
+    /**
+     * Waits until everything published before the call is written to the
+     * sink and the sink is flushed.
+     */
+    void drain()
+    {
+        marker m;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if (!_writer.joinable()) return;
+        }
+        push(&m.n);
+        std::unique_lock<std::mutex> lock{_mutex};
+        _drained_cond.wait(lock, [&m] { return m.done; });
+    }
+
+    /**
+     * Lets the writer thread write out the queued records, flush the sink
+     * and exit. No thread may have a record open or start one afterwards.
+     * Called automatically on destruction.
+     */
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if (!_writer.joinable()) return;
+            _stop.store(true, std::memory_order_relaxed);
+        }
+        _cond.notify_one();
+        _writer.join();
+    }
+
+    /**
+     * Does not lock, so it may be checked after every record.
+     *
+     * @return <code>false</code> once the sink failed to write; the records
+     *         published since then are dropped.
+     */
+    bool good() const { return !_failed.load(std::memory_order_acquire); }
+
+    /**
+     * The writer thread owns the sink until <code>close</code> returns;
+     * before that only the sink's own thread-safe members may be used.
+     *
+     * @return reference to the wrapped sink.
+     */
+    Sink& sink() { return _sink; }
+    /**
+     * @see sink()
+     */
+    const Sink& sink() const { return _sink; }
+
+private:
+    /* Block of a thread's buffer. pending counts its records not yet
+     * written by the writer thread. */
+    struct chunk
+    {
+        std::atomic<std::size_t> pending{0};
+        std::size_t size;
+
+        char_type* data() { return reinterpret_cast<char_type*>(this + 1); }
+    };
+
+    /* Published record, placed in the chunk right before its characters.
+     * Drain markers have no chunk. */
+    struct node
+    {
+        std::atomic<node*> next{nullptr};
+        chunk* owner = nullptr;
+        std::size_t size = 0;
+
+        const char_type* data() const { return reinterpret_cast<const char_type*>(this + 1); }
+    };
+
+    struct marker
+    {
+        node n;
+        bool done = false;
+    };
+
+    static constexpr std::size_t _header = (sizeof(node) + sizeof(char_type) - 1) / sizeof(char_type);
+    /* Number of instances each thread finds its producer of without locking. */
+    static constexpr std::size_t _cached = 8;
+
+    /* Buffer provider of a thread's stream. Hands out the chunk space; the
+     * characters of the open record (with the room for its node) are moved
+     * to the next chunk when the current one is full. */
+    class record_buffer
+    {
+    public:
+        typedef typename Sink::char_type char_type;
+        typedef out_buffer_provider      category;
+
+        explicit record_buffer(shared_outstream* owner) : _owner{owner} {}
+        record_buffer(const record_buffer& ) = delete;
+        record_buffer& operator=(const record_buffer& ) = delete;
+
+        ~record_buffer() noexcept
+        {
+            release(_chunk);
+            for (chunk* c : _retired) release(c);
+        }
+
+        std::pair<char_type*, std::size_t> get_out_buffer()
+        {
+            std::size_t keep = 0;
+            if (_record) keep = static_cast<std::size_t>(_chunk->data() + _chunk->size - _record);
+            chunk* next = acquire(std::max(_owner->_params.chunk_size, 2 * keep));
+            if (keep > 0) traits_type::copy(next->data(), _record, keep);
+            if (_record) _record = next->data();
+            if (_chunk) _retired.push_back(_chunk);
+            _chunk = next;
+            _mark = next->data() + keep;
+            return {_mark, next->size - keep};
+        }
+
+        void flush(std::size_t size) { _mark += size; }
+
+        /* Reserves the room for the node at the current stream position. */
+        void open(char_type* pos) { _record = pos; }
+
+        /* Turns the characters written since open into a node. */
+        node* close()
+        {
+            if (!_record) return nullptr;
+            node* n = ::new (static_cast<void*>(_record)) node{};
+            n->owner = _chunk;
+            n->size = static_cast<std::size_t>(_mark - _record) - _header;
+            _record = nullptr;
+            _chunk->pending.fetch_add(1, std::memory_order_relaxed);
+            return n;
+        }
+
+    private:
+        /* Reuses a chunk the writer thread is done with or allocates a new
+         * one, waiting for the writer when too many are in flight. */
+        chunk* acquire(std::size_t size)
+        {
+            for (;;)
+            {
+                for (std::size_t i = 0; i < _retired.size(); ++i)
+                {
+                    chunk* c = _retired[i];
+                    if (c->pending.load(std::memory_order_acquire) != 0) continue;
+                    _retired[i] = _retired.back();
+                    _retired.pop_back();
+                    if (c->size >= size && c->size <= std::max(size, _owner->_params.chunk_size)) return c;
+                    /* Oversized chunks of long records are not kept. */
+                    release(c);
+                    --i;
+                }
+                if (_retired.size() + 1 < _owner->_params.chunks) break;
+                std::this_thread::yield();
+            }
+            void* mem = ::operator new(sizeof(chunk) + size * sizeof(char_type));
+            chunk* c = ::new (mem) chunk{};
+            c->size = size;
+            return c;
+        }
+
+        static void release(chunk* c)
+        {
+            if (!c) return;
+            c->~chunk();
+            ::operator delete(static_cast<void*>(c));
+        }
+
+        shared_outstream* _owner;
+        chunk* _chunk = nullptr;
+        std::vector<chunk*> _retired;
+        /* Start of the open record (its node room) and the stream position
+         * as of the last flush. */
+        char_type* _record = nullptr;
+        char_type* _mark = nullptr;
+    };
+
+    struct producer
+    {
+        explicit producer(shared_outstream* owner) : out{owner}, _owner{owner} {}
+
+        void begin()
+        {
+            out.clear();
+            auto span = out.out_span();
+            std::size_t pad = span.first ? padding(span.first) : 0;
+            if (span.first && span.second < pad + _header)
+            {
+                /* Not enough room for the node: skip the tail of the chunk. */
+                out.commit(span.second);
+                span = out.out_span();
+                pad = span.first ? padding(span.first) : 0;
+            }
+            if (!span.first)
+            {
+                out.setstate(std::ios_base::badbit);
+                return;
+            }
+            out->open(span.first + pad);
+            out.commit(pad + _header);
+        }
+
+        void end()
+        {
+            /* Not out.flush(): it is skipped when the stream has failbit set. */
+            out.rdbuf()->pubsync();
+            node* n = out->close();
+            if (n) _owner->push(n);
+        }
+
+        static std::size_t padding(const char_type* pos)
+        {
+            std::size_t mis = reinterpret_cast<std::uintptr_t>(pos) % alignof(node);
+            return mis == 0 ? 0 : (alignof(node) - mis) / sizeof(char_type);
+        }
+
+        outstream<record_buffer> out;
+        shared_outstream* _owner;
+    };
+
+    /* A chunk must hold a node with some characters, and a thread needs
+     * one chunk to write to while another is in flight. */
+    static shared_params checked(shared_params params)
+    {
+        params.chunk_size = std::max<std::size_t>(params.chunk_size, 4 * _header);
+        params.chunks = std::max<std::size_t>(params.chunks, 2);
+        params.batch_size = std::max<std::size_t>(params.batch_size, 1);
+        return params;
+    }
+
+    static std::uint64_t next_id()
+    {
+        static std::atomic<std::uint64_t> ids{0};
+        return ++ids;
+    }
+
+    /* Producer of the calling thread. Each thread remembers its producers
+     * of the last few instances, keyed by id rather than address since a
+     * new instance may take the place of a destroyed one; only a thread
+     * new to the instance, or one alternating between more instances,
+     * takes the mutex. */
+    producer& local()
+    {
+        struct cache
+        {
+            std::uint64_t id;
+            producer* p;
+        };
+        static thread_local cache recent[_cached] = {};
+        static thread_local std::size_t victim = 0;
+        for (const cache& c : recent)
+        {
+            if (c.id == _id) return *c.p;
+        }
+        std::lock_guard<std::mutex> lock{_mutex};
+        auto& p = _producers[std::this_thread::get_id()];
+        /* A thread id is only reused after the thread has finished, so its
+         * producer is free to take over. */
+        if (!p) p.reset(new producer{this});
+        recent[victim] = {_id, p.get()};
+        victim = (victim + 1) % _cached;
+        return *p;
+    }
+
+    /* Intrusive multi-producer single-consumer queue (D. Vyukov): producers
+     * only exchange the head, the writer thread owns the tail. */
+    void push(node* n)
+    {
+        n->next.store(nullptr, std::memory_order_relaxed);
+        /* Sequentially consistent with _sleeping in run(): either the writer
+         * sees this node or this thread sees it sleeping. */
+        node* prev = _head.exchange(n, std::memory_order_seq_cst);
+        prev->next.store(n, std::memory_order_release);
+        if (_sleeping.load(std::memory_order_seq_cst))
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            _cond.notify_one();
+        }
+    }
+
+    node* pop()
+    {
+        node* tail = _tail;
+        node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &_stub)
+        {
+            if (!next) return nullptr;
+            _tail = tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next)
+        {
+            _tail = next;
+            return tail;
+        }
+        if (tail != _head.load(std::memory_order_acquire)) return nullptr;
+        _stub.next.store(nullptr, std::memory_order_relaxed);
+        node* prev = _head.exchange(&_stub, std::memory_order_acq_rel);
+        prev->next.store(&_stub, std::memory_order_release);
+        next = tail->next.load(std::memory_order_acquire);
+        if (!next) return nullptr;
+        _tail = next;
+        return tail;
+    }
+
+    void run()
+    {
+        std::vector<char_type> batch(_params.batch_size);
+        std::size_t used = 0;
+        bool written = false;
+        for (;;)
+        {
+            if (node* n = pop())
+            {
+                if (!n->owner)
+                {
+                    write(batch.data(), used);
+                    used = 0;
+                    if (!_failed.load(std::memory_order_relaxed)) _sink.flush();
+                    written = false;
+                    std::lock_guard<std::mutex> lock{_mutex};
+                    reinterpret_cast<marker*>(n)->done = true;
+                    _drained_cond.notify_all();
+                    continue;
+                }
+                if (used + n->size > batch.size())
+                {
+                    write(batch.data(), used);
+                    used = 0;
+                }
+                if (n->size >= batch.size()) write(n->data(), n->size);
+                else
+                {
+                    traits_type::copy(batch.data() + used, n->data(), n->size);
+                    used += n->size;
+                }
+                written = true;
+                n->owner->pending.fetch_sub(1, std::memory_order_release);
+                continue;
+            }
+            if (_head.load(std::memory_order_acquire) != _tail)
+            {
+                /* A producer is in the middle of push. */
+                std::this_thread::yield();
+                continue;
+            }
+            write(batch.data(), used);
+            used = 0;
+            if (written && !_failed.load(std::memory_order_relaxed)) _sink.flush();
+            written = false;
+            std::unique_lock<std::mutex> lock{_mutex};
+            _sleeping.store(true, std::memory_order_seq_cst);
+            bool empty = _head.load(std::memory_order_seq_cst) == _tail;
+            if (empty && _stop.load(std::memory_order_relaxed)) return;
+            if (empty) _cond.wait(lock);
+            _sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void write(const char_type* s, std::size_t size)
+    {
+        if (size == 0 || _failed.load(std::memory_order_relaxed)) return;
+        auto n = static_cast<std::streamsize>(size);
+        if (_sink.write(s, n) < n) _failed.store(true, std::memory_order_release);
+    }
+
+    Sink _sink;
+    shared_params _params;
+    const std::uint64_t _id = next_id();
+
+    node _stub;
+    std::atomic<node*> _head{&_stub};
+    node* _tail = &_stub;
+
+    std::atomic<bool> _sleeping{false};
+    std::atomic<bool> _stop{false};
+    std::atomic<bool> _failed{false};
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::condition_variable _drained_cond;
+    std::unordered_map<std::thread::id, std::unique_ptr<producer>> _producers;
+    /* Started by the constructors, so it goes after everything run() uses. */
+    std::thread _writer;
+};
+
+} // end of nova namespace
+
+#endif // NOVA_SHARED_OUTSTREAM_H
@@ -0,0 +1,152 @@
+/*
+Copyright (c) 2016 Alexei Novakov
+https://github.com/novalexei
+
+Distributed under the Boost Software License, Version 1.0.
+http://boost.org/LICENSE_1_0.txt
+*/
+#ifndef NOVA_STREAM_POOL_H
+#define NOVA_STREAM_POOL_H
+
+#include <nova/io.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * @file stream_pool.h
+ * @brief Pool of reusable stream objects.
+ *
+ * Constructing a stream initializes <code>std::ios_base</code>, the locale
+ * and the stream buffer, which dominates the cost of formatting a small
+ * message. The pool keeps released streams and hands them out again
+ * rebound to a new sink or source (see <code>outstream::rebind</code>):
+ *
+ * ~~~~~{.cpp}
+ * thread_local nova::stream_pool<nova::outstream<message_sink, nova::buffer_256>> pool;
+ *
+ * auto out = pool.acquire(message);
+ * *out << "id=" << id;
+ * ~~~~~
+ */
+
+namespace nova {
+
+/**
+ * Pool of streams of type <code>Stream</code>, which is nova::outstream,
+ * nova::instream, nova::inline_outstream or nova::inline_instream (or any
+ * type with a constructor and <code>rebind</code> taking the same
+ * arguments).
+ *
+ * <code>acquire</code> returns a handle which gives the stream back to the
+ * pool when destroyed; output streams are flushed at that point. Streams
+ * failing to flush and streams beyond <code>max_idle</code> are destroyed
+ * instead. The sink or source of an idle stream stays alive until the
+ * stream is acquired again or the pool is cleared.
+ *
+ * The pool is not thread-safe: use a pool per thread. Handles must not
+ * outlive the pool.
+ *
+ * @tparam Stream stream type
+ */
+template<typename Stream>
+class stream_pool
+{
+public:
+    /**
+     * Returns the stream to the pool.
+     */
+    class releaser
+    {
+    public:
+        releaser() = default;
+        explicit releaser(stream_pool* pool) : _pool{pool} {}
+
+        void operator()(Stream* stream) const noexcept { _pool->release(stream); }
+
+    private:
+        stream_pool* _pool = nullptr;
+    };
+
+    /**
+     * Owning handle of an acquired stream.
+     */
+    typedef std::unique_ptr<Stream, releaser> handle;
+
+    /**
+     * @param max_idle maximum number of idle streams kept
+     */
+    explicit stream_pool(std::size_t max_idle = 16) : _max_idle{max_idle} {}
+
+    stream_pool(const stream_pool& ) = delete;
+    stream_pool& operator=(const stream_pool& ) = delete;
+
+    /**
+     * Provides a stream over the sink or source constructed from
+     * <code>args</code>: an idle stream rebound to it or a new one.
+     *
+     * @param args Arguments to be forwarded to construct the <code>Sink</code>
+     *             or <code>Source</code>
+     * @return handle of the stream.
+     */
+    template<class... Args>
+    handle acquire(Args&&... args)
+    {
+        if (_idle.empty()) return handle{new Stream(std::forward<Args>(args)...), releaser{this}};
+        std::unique_ptr<Stream> stream = std::move(_idle.back());
+        _idle.pop_back();
+        stream->rebind(std::forward<Args>(args)...);
+        return handle{stream.release(), releaser{this}};
+    }
+
+    /**
+     * @return number of idle streams.
+     */
+    std::size_t idle() const { return _idle.size(); }
+
+    /**
+     * Destroys the idle streams.
+     */
+    void clear() noexcept { _idle.clear(); }
+
+private:
+    void release(Stream* stream) noexcept
+    {
+        std::unique_ptr<Stream> owned{stream};
+        if (!flush(*stream, 0)) return;
+        if (_idle.size() < _max_idle)
+        {
+            try
+            {
+                _idle.push_back(std::move(owned));
+            }
+            catch (...) { }
+        }
+    }
+
+    /* Output streams only. The handle cannot report errors: a stream which
+     * fails to flush is destroyed instead of being kept. */
+    template<typename S>
+    static auto flush(S& stream, int) -> decltype(stream.flush(), bool())
+    {
+        try
+        {
+            stream.exceptions(std::ios_base::goodbit);
+            stream.flush();
+        }
+        catch (...)
+        {
+            return false;
+        }
+        return !stream.bad();
+    }
+    template<typename S>
+    static bool flush(S& , ...) { return true; }
+
+    std::size_t _max_idle;
+    std::vector<std::unique_ptr<Stream>> _idle;
+};
+
+} // end of nova namespace
+
+#endif // NOVA_STREAM_POOL_H
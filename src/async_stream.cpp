@@ -0,0 +1,52 @@
+#include <nova/epoll_reactor.h>
+
+#include <iostream>
+
+#include <sys/socket.h>
+
+using namespace nova;
+
+task<> echo_server(async_fd& fd)
+{
+    async_device_instream<async_fd, buffer_4k> in{fd};
+    async_device_outstream<async_fd, buffer_4k> out{fd};
+    std::string line;
+    for (;;)
+    {
+        bool got = co_await in.read_line(line);
+        if (!got) break;
+        co_await out.write(std::string_view{"echo: "});
+        co_await out.write(line);
+        co_await out.write(std::string_view{"\n"});
+        co_await out.flush();
+    }
+}
+
+task<> client(async_fd& fd)
+{
+    async_device_instream<async_fd, buffer_4k> in{fd};
+    async_device_outstream<async_fd, buffer_4k> out{fd};
+    std::string line;
+    for (std::string_view message : {"hello", "asynchronous", "world"})
+    {
+        co_await out.write(message);
+        co_await out.write(std::string_view{"\n"});
+        co_await out.flush();
+        co_await in.read_line(line);
+        std::cout << line << std::endl;
+    }
+    ::shutdown(fd.fd(), SHUT_WR);
+}
+
+int main()
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) return 1;
+    epoll_reactor reactor;
+    async_fd server_fd{reactor, fds[0]};
+    async_fd client_fd{reactor, fds[1]};
+    reactor.spawn(echo_server(server_fd));
+    reactor.spawn(client(client_fd));
+    reactor.run();
+    return 0;
+}
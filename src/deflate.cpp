@@ -0,0 +1,61 @@
+#include <nova/deflate_filter.h>
+
+using namespace nova;
+
+template<typename CharT>
+class string_sink
+{
+public:
+    typedef sink                          category;
+
+    typedef CharT                         char_type;
+    typedef std::basic_string<CharT>      string_type;
+
+    std::streamsize write(const char_type* s, std::streamsize n)
+    {
+        _buffer.append(s, n);
+        return n;
+    }
+    void flush() { }
+
+    const string_type& str() const { return _buffer; }
+private:
+    string_type _buffer;
+};
+
+template<class CharT>
+class string_view_buffer_provider
+{
+public:
+    typedef in_buffer_provider            category;
+
+    typedef CharT                         char_type;
+    typedef std::basic_string_view<CharT> string_view_type;
+
+    explicit string_view_buffer_provider(string_view_type str) : _str{str} {}
+
+    std::pair<const char_type*, std::size_t> get_in_buffer()
+    {
+        if (_buffer_provided) return {nullptr, 0};
+        _buffer_provided = true;
+        return {_str.data(), static_cast<std::size_t>(_str.size())};
+    }
+private:
+    string_view_type _str;
+    bool _buffer_provided = false;
+};
+
+int main()
+{
+    deflate_outstream<string_sink<char>> out;
+    out << 123 << ' ' << 456;
+    out.flush();
+    out->close();
+    std::cout << "compressed to " << out->sink().str().size() << " bytes" << std::endl;
+
+    deflate_instream<string_view_buffer_provider<char>> in{out->sink().str()};
+    int i1, i2;
+    in >> i1 >> i2;
+    std::cout << i1 << ' ' << i2 << std::endl;
+    return 0;
+}
@@ -25,18 +25,26 @@ public:
     }
     void flush() { }
 
-    /* in_buffer_provider function */
+    /* in_buffer_provider functions */
     std::pair<const char_type*, std::size_t> get_in_buffer()
     {
         if (_in_size == _buffer.size()) return {nullptr, 0};
-        auto in_start = _in_size;
+        _in_start = _in_size;
         _in_size = _buffer.size();
-        return {_buffer.data() + in_start, _in_size};
+        return {_buffer.data() + _in_start, _in_size - _in_start};
+    }
+    void release_in_buffer(const char_type* , std::size_t consumed)
+    {
+        /* Read data is not needed anymore: the string does not grow forever. */
+        _buffer.erase(0, _in_start + consumed);
+        _in_start = 0;
+        _in_size = 0;
     }
 
     string_view_type view() const { return string_view_type{_buffer}; }
 private:
     string_type _buffer;
+    std::size_t _in_start = 0;
     std::size_t _in_size = 0;
 };
 
@@ -46,9 +54,14 @@ int main()
     device_instream<string_device<char>> in{device};
     device_outstream<string_device<char>> out{device};
     out << 123 << ' ' << 456;
+    std::cout << device.view() << std::endl;
     int i1, i2;
     in >> i1 >> i2;
-    std::cout << device.view() << std::endl;
     std::cout << i1 << ' ' << i2 << std::endl;
+    out << ' ' << 789;
+    int i3;
+    in.clear();
+    in >> i3;
+    std::cout << i3 << ", " << device.view().size() << " characters kept" << std::endl;
     return 0;
 }
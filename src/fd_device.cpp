@@ -0,0 +1,31 @@
+#include <nova/fd_device.h>
+
+#include <cstdio>
+
+using namespace nova;
+
+int main()
+{
+    const char* file_name = "fd_device.txt";
+    {
+        outstream<file_sink, buffer_16> out{file_name};
+        out << 123 << ' ' << 456;
+        out.flush();
+    }
+    {
+        fd_device device{file_name, std::ios_base::in | std::ios_base::out};
+        device_outstream<fd_device> out{device};
+        device_instream<fd_device, buffer_16> in{device};
+        out << ' ' << 789;
+        out.flush();
+        int i1, i2, i3;
+        in >> i1 >> i2 >> i3;
+        std::cout << i1 << ' ' << i2 << ' ' << i3 << std::endl;
+        in.clear();
+        in.seekg(4);
+        in >> i2;
+        std::cout << i2 << " at " << in.tellg() << std::endl;
+    }
+    std::remove(file_name);
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include <nova/filter.h>
+
+#include <cctype>
+
+using namespace nova;
+
+template<typename CharT>
+class string_sink
+{
+public:
+    typedef sink                          category;
+
+    typedef CharT                         char_type;
+    typedef std::basic_string<CharT>      string_type;
+    typedef std::basic_string_view<CharT> string_view_type;
+
+    std::streamsize write(const char_type* s, std::streamsize n)
+    {
+        _buffer.append(s, n);
+        return n;
+    }
+    void flush() { }
+
+    string_view_type view() const { return string_view_type{_buffer}; }
+private:
+    string_type _buffer;
+};
+
+class upper_case_filter
+{
+public:
+    typedef char   char_type;
+    typedef filter category;
+
+    template<typename Next>
+    std::streamsize write(Next& next, const char_type* s, std::streamsize n)
+    {
+        char_type buf[256];
+        std::streamsize done = 0;
+        while (done < n)
+        {
+            std::streamsize chunk = std::min<std::streamsize>(n - done, sizeof(buf));
+            for (std::streamsize i = 0; i < chunk; ++i) buf[i] = static_cast<char_type>(std::toupper(s[done + i]));
+            if (next.write(buf, chunk) < chunk) return done;
+            done += chunk;
+        }
+        return done;
+    }
+
+    template<typename Next>
+    void flush(Next& ) { }
+};
+
+int main()
+{
+    filtered_outstream<string_sink<char>, upper_case_filter, crc32c_filter> out;
+    out << "abc " << 123 << ' ' << 456;
+    out.flush();
+    std::cout << out->sink().view() << std::endl;
+    std::cout << std::hex << out->filter<crc32c_filter>().value() << std::endl;
+    return 0;
+}
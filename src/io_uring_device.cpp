@@ -0,0 +1,29 @@
+#include <nova/io_uring_device.h>
+
+#include <cstdio>
+
+using namespace nova;
+
+int main()
+{
+    const char* file_name = "io_uring_device.txt";
+    {
+        outstream<io_uring_sink> out{file_name};
+        out << 123 << ' ' << 456;
+        out.flush();
+        std::cout << (out->uring() ? "io_uring" : "pread/pwrite fallback") << std::endl;
+    }
+    {
+        io_uring_device device{file_name, std::ios_base::in | std::ios_base::out};
+        device_outstream<io_uring_device> out{device};
+        device_instream<io_uring_device> in{device};
+        out << ' ' << 789;
+        out.flush();
+        device.drain();
+        int i1, i2, i3;
+        in >> i1 >> i2 >> i3;
+        std::cout << i1 << ' ' << i2 << ' ' << i3 << std::endl;
+    }
+    std::remove(file_name);
+    return 0;
+}
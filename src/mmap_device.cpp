@@ -0,0 +1,24 @@
+#include <nova/mmap_device.h>
+
+#include <cstdio>
+
+using namespace nova;
+
+int main()
+{
+    const char* file_name = "mmap_device.txt";
+    {
+        mmap_device device{file_name, std::ios_base::in | std::ios_base::out | std::ios_base::trunc};
+        device_outstream<mmap_device> out{device};
+        device_instream<mmap_device> in{device};
+        out << 123 << ' ' << 456;
+        out.flush();
+        int i1, i2;
+        in >> i1 >> i2;
+        std::cout << i1 << ' ' << i2 << std::endl;
+    }
+    instream<mmap_source> in{file_name};
+    std::cout << in.rdbuf() << std::endl;
+    std::remove(file_name);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <nova/ring_device.h>
+
+#include <thread>
+
+using namespace nova;
+
+int main()
+{
+    /* Small ring: the producer waits for the consumer many times. */
+    ring_device ring{16};
+    std::thread producer{[&ring]
+    {
+        device_outstream<ring_device> out{ring};
+        for (int i = 1; i <= 100; ++i) out << i << ' ';
+        out.flush();
+        ring.close();
+    }};
+    device_instream<ring_device> in{ring};
+    int i, count = 0;
+    long sum = 0;
+    while (in >> i)
+    {
+        sum += i;
+        ++count;
+    }
+    producer.join();
+    std::cout << count << " numbers, sum " << sum << std::endl;
+    return 0;
+}
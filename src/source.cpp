@@ -1,5 +1,7 @@
 #include <nova/io.h>
+#include <nova/fast_parse.h>
 
+#include <limits>
 #include <utility>
 
 using namespace nova;
@@ -35,5 +37,16 @@ int main()
     int i1, i2;
     in >> i1 >> i2;
     std::cout << i1 << " " << i2 << std::endl;
+
+    /* Unbuffered: every number fast_parse reads crosses a buffer boundary.
+     * Out of range ones must come out as num_get gives them. */
+    instream<string_source<char>> far{std::string{"1e400 1e-400 2"}};
+    double d1, d2, d3;
+    far >> fast_parse >> d1;
+    if (!far.fail() || d1 != std::numeric_limits<double>::max()) return 1;
+    far.clear();
+    far >> fast_parse >> d2 >> d3;
+    if (far.fail() || d2 != 0 || d3 != 2) return 1;
+    std::cout << d1 << " " << d2 << " " << d3 << std::endl;
     return 0;
 }